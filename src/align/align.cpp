@@ -19,14 +19,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ****/
 
 #include <memory>
+#include <atomic>
+#include <algorithm>
 #include "../basic/value.h"
 #include "align.h"
 #include "../data/reference.h"
 #include "../output/output_format.h"
-#include "../util/queue.h"
+#include "../util/parallel/thread_pool.h"
 #include "../output/output.h"
 #include "legacy/query_mapper.h"
-#include "../util/merge_sort.h"
 #include "extend.h"
 
 using namespace std;
@@ -35,50 +36,62 @@ DpStat dp_stat;
 
 struct Align_fetcher
 {
-	static void init(size_t qbegin, size_t qend, vector<hit>::iterator begin, vector<hit>::iterator end)
+	static void init(size_t qbegin, size_t qend, vector<hit>::iterator begin, vector<hit>::iterator end, size_t thread_count)
 	{
-		it_ = begin;
-		end_ = end;
-		queue_ = unique_ptr<Queue>(new Queue(qbegin, qend));
+		const size_t n = qend - qbegin, c = align_mode.query_contexts;
+		hits_ = begin;
+		qbegin_ = qbegin;
+		qend_ = qend;
+		next_ = qbegin;
+		batch_size_ = std::max(std::min(n / (thread_count * 16), (size_t)MAX_BATCH_SIZE), (size_t)1);
+		query_begin_.resize(n + 1);
+		Util::Parallel::ThreadPool::get().run(config.threads_, n + 1, [&](size_t i, size_t) {
+			query_begin_[i] = std::lower_bound(begin, end, qbegin + i, [c](const hit &h, size_t q) { return h.query_ / c < q; }) - begin;
+		});
 	}
-	bool operator()(size_t query)
+	Align_fetcher():
+		next_query_(0),
+		batch_end_(0)
+	{}
+	bool get()
 	{
-		const unsigned q = (unsigned)query,
-			c = align_mode.query_contexts;
-		begin = it_;
-		while (it_ < end_ && it_->query_ / c == q)
-			++it_;
-		end = it_;
-		this->query = query;
+		if (next_query_ >= batch_end_) {
+			next_query_ = next_.fetch_add(batch_size_, std::memory_order_relaxed);
+			if (next_query_ >= qend_)
+				return false;
+			batch_end_ = std::min(next_query_ + batch_size_, qend_);
+		}
+		query = next_query_++;
+		begin = hits_ + query_begin_[query - qbegin_];
+		end = hits_ + query_begin_[query - qbegin_ + 1];
 		target_parallel = (end - begin > config.query_parallel_limit) && ((config.frame_shift != 0 && align_mode.mode == Align_mode::blastx && config.toppercent < 100 && config.query_range_culling)
 			|| config.ext == Config::banded_swipe);
-		return target_parallel;
-	}
-	bool get()
-	{
-		return queue_->get(*this) != Queue::end;
-	}
-	void release() {
-		if (target_parallel)
-			queue_->release();
+		return true;
 	}
 	size_t query;
 	vector<hit>::iterator begin, end;
 	bool target_parallel;
-private:	
-	static vector<hit>::iterator it_, end_;
-	static unique_ptr<Queue> queue_;
+	enum : size_t { MAX_BATCH_SIZE = 16 };
+private:
+	size_t next_query_, batch_end_;
+	static std::atomic<size_t> next_;
+	static size_t qbegin_, qend_, batch_size_;
+	static vector<hit>::iterator hits_;
+	static vector<size_t> query_begin_;
 };
 
-unique_ptr<Queue> Align_fetcher::queue_;
-vector<hit>::iterator Align_fetcher::it_;
-vector<hit>::iterator Align_fetcher::end_;
+std::atomic<size_t> Align_fetcher::next_;
+size_t Align_fetcher::qbegin_;
+size_t Align_fetcher::qend_;
+size_t Align_fetcher::batch_size_;
+vector<hit>::iterator Align_fetcher::hits_;
+vector<size_t> Align_fetcher::query_begin_;
 
 TextBuffer* legacy_pipeline(Align_fetcher &hits, const sequence *subjects, size_t subject_count, const Metadata *metadata, const Parameters *params, Statistics &stat) {
 	if ((hits.end == hits.begin) && subjects == nullptr) {
 		TextBuffer *buf = nullptr;
 		if (!blocked_processing && *output_format != Output_format::daa && config.report_unaligned != 0) {
-			buf = new TextBuffer;
+			buf = OutputSink::get().get_buffer();
 			const char *query_title = query_ids::get()[hits.query].c_str();
 			output_format->print_query_intro(hits.query, query_title, get_source_query_len((unsigned)hits.query), *buf, true);
 			output_format->print_query_epilog(*buf, query_title, true, *params);
@@ -101,7 +114,7 @@ TextBuffer* legacy_pipeline(Align_fetcher &hits, const sequence *subjects, size_
 	timer.go("Generating output");
 	TextBuffer *buf = nullptr;
 	if (*output_format != Output_format::null) {
-		buf = new TextBuffer;
+		buf = OutputSink::get().get_buffer();
 		const bool aligned = mapper->generate_output(*buf, stat);
 		if (aligned && (!config.unaligned.empty() || !config.aligned_file.empty())) {
 			query_aligned_mtx.lock();
@@ -122,7 +135,6 @@ void align_worker(size_t thread_id, const Parameters *params, const Metadata *me
 		if(config.ext != Config::banded_swipe) {
 			TextBuffer *buf = legacy_pipeline(hits, subjects, subject_count, metadata, params, stat);
 			OutputSink::get().push(hits.query, buf);
-			hits.release();
 			continue;
 		}
 		vector<Extension::Match> matches = Extension::extend(*params, hits.query, hits.begin, hits.end, *metadata, stat, hits.target_parallel ? Extension::TARGET_PARALLEL : 0);
@@ -133,7 +145,6 @@ void align_worker(size_t thread_id, const Parameters *params, const Metadata *me
 			query_aligned_mtx.unlock();
 		}
 		OutputSink::get().push(hits.query, buf);
-		hits.release();
 	}
 	statistics += stat;
 	::dp_stat += dp_stat;
@@ -159,19 +170,21 @@ void align_queries(Trace_pt_buffer &trace_pts, Consumer* output_file, const Para
 			break;
 		}
 		timer.go("Sorting trace points");
-		merge_sort(v->begin(), v->end(), config.threads_);
+		sort_trace_points(*v, query_range.first, query_range.second, config.threads_);
 		v->init();
 		timer.go("Computing alignments");
-		Align_fetcher::init(query_range.first, query_range.second, v->begin(), v->end());
-		OutputSink::instance = unique_ptr<OutputSink>(new OutputSink(query_range.first, output_file));
-		vector<thread> threads;
-		if (config.verbosity >= 3 && config.load_balancing == Config::query_parallel)
-			threads.emplace_back(heartbeat_worker, query_range.second);
 		size_t n_threads = config.load_balancing == Config::query_parallel ? (config.threads_align == 0 ? config.threads_ : config.threads_align) : 1;
-		for (size_t i = 0; i < n_threads; ++i)
-			threads.emplace_back(align_worker, i, &params, &metadata, subjects.empty() ? nullptr : subjects.data(), subjects.size());
-		for (auto &t : threads)
-			t.join();
+		Align_fetcher::init(query_range.first, query_range.second, v->begin(), v->end(), n_threads);
+		OutputSink::instance = unique_ptr<OutputSink>(new OutputSink(query_range.first, output_file, std::max(n_threads * Align_fetcher::MAX_BATCH_SIZE * 64, (size_t)4096)));
+		thread heartbeat;
+		if (config.verbosity >= 3 && config.load_balancing == Config::query_parallel)
+			heartbeat = thread(heartbeat_worker, query_range.second);
+		// Workers run as pool tasks, so the parallel stages of target-parallel queries are nested loops that do not stall the other workers.
+		Util::Parallel::ThreadPool::get().run(n_threads, n_threads, [&](size_t i, size_t) {
+			align_worker(i, &params, &metadata, subjects.empty() ? nullptr : subjects.data(), subjects.size());
+		});
+		if (heartbeat.joinable())
+			heartbeat.join();
 		timer.finish();
 
 		double t = timer.get();
@@ -181,6 +194,14 @@ void align_queries(Trace_pt_buffer &trace_pts, Consumer* output_file, const Para
 		log_stream << "Net cells = " << dp_stat.net_cells << endl;
 		log_stream << "Net GCUPS = " << (double)dp_stat.net_cells / 1e9 / t << endl;
 		log_stream << "Net GCUPS/thread = " << (double)dp_stat.net_cells / n_threads / 1e9 / t << endl;
+		log_stream << "Lane occupancy = " << (dp_stat.gross_cells ? (double)dp_stat.net_cells / dp_stat.gross_cells : 0.0) << endl;
+		log_stream << "Banded swipe batches (total/partial) = " << dp_stat.batches << '/' << dp_stat.partial_batches << endl;
+		log_stream << "Mean batch lane occupancy = " << (dp_stat.batches ? dp_stat.batch_occupancy / dp_stat.batches : 0.0) << endl;
+		log_stream << "Banded swipe targets (inter-sequence/intra-sequence) = " << dp_stat.inter_targets << '/' << dp_stat.intra_targets << endl;
+		log_stream << "Targets aligned with 32 bit scores by score hint = " << dp_stat.wide_targets << endl;
+		log_stream << "Targets recomputed after 16 bit overflow = " << dp_stat.overflow_targets << endl;
+		log_stream << "Cells wasted on overflow = " << dp_stat.overflow_cells << endl;
+		log_stream << "Targets with checkpointed traceback = " << dp_stat.checkpointed_targets << endl;
 
 		timer.go("Deallocating buffers");
 		delete v;
@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../data/queries.h"
 #include "../basic/config.h"
 #include "../dp/comp_based_stats.h"
+#include "../data/query_cache.h"
 #include "target.h"
 #include "../dp/dp.h"
 #include "../util/log_stream.h"
@@ -35,7 +36,8 @@ namespace Extension {
 vector<Match> extend(const Parameters &params, size_t query_id, Trace_pt_list::iterator begin, Trace_pt_list::iterator end, const Metadata &metadata, Statistics &stat, int flags) {
 	const unsigned contexts = align_mode.query_contexts;
 	vector<sequence> query_seq;
-	vector<Bias_correction> query_cb;
+	vector<Bias_correction> query_cb_buf;
+	const Bias_correction *query_cb = nullptr;
 
 	if (config.log_query || flags & TARGET_PARALLEL)
 		log_stream << "Query = " << query_ids::get()[query_id].c_str() << endl;
@@ -46,14 +48,19 @@ vector<Match> extend(const Parameters &params, size_t query_id, Trace_pt_list::i
 	task_timer timer(flags & TARGET_PARALLEL ? 3 : UINT_MAX);
 	if (config.comp_based_stats == 1) {
 		timer.go("Computing CBS");
-		for (unsigned i = 0; i < contexts; ++i)
-			query_cb.emplace_back(query_seq[i]);
+		if (query_cache.enabled())
+			query_cb = query_cache.bias_correction(query_id);
+		else {
+			for (unsigned i = 0; i < contexts; ++i)
+				query_cb_buf.emplace_back(query_seq[i]);
+			query_cb = query_cb_buf.data();
+		}
 		timer.finish();
 	}
 
 	const int source_query_len = align_mode.query_translated ? (int)query_source_seqs::get()[query_id].length() : (int)query_seqs::get()[query_id].length();
 
-	vector<WorkTarget> targets = ungapped_stage(query_seq.data(), query_cb.data(), begin, end, flags);
+	vector<WorkTarget> targets = ungapped_stage(query_seq.data(), query_cb, begin, end, flags);
 	stat.inc(Statistics::TARGET_HITS0, targets.size());
 
 	timer.go("Computing ranking");
@@ -61,13 +68,13 @@ vector<Match> extend(const Parameters &params, size_t query_id, Trace_pt_list::i
 	stat.inc(Statistics::TARGET_HITS1, targets.size());
 	timer.finish();
 
-	vector<Target> aligned_targets = align(targets, query_seq.data(), query_cb.data(), flags);
+	vector<Target> aligned_targets = align(targets, query_seq.data(), query_cb, flags);
 	timer.go("Computing score only culling");
 	score_only_culling(aligned_targets);
 	stat.inc(Statistics::TARGET_HITS2, aligned_targets.size());
 	timer.finish();
 
-	vector<Match> matches = align(aligned_targets, query_seq.data(), query_cb.data(), source_query_len, flags);
+	vector<Match> matches = align(aligned_targets, query_seq.data(), query_cb, source_query_len, flags);
 	timer.go("Computing culling");
 	culling(matches, source_query_len, query_ids::get()[query_id].c_str());
 	stat.inc(Statistics::TARGET_HITS3, matches.size());
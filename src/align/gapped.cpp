@@ -50,7 +50,7 @@ void add_dp_targets(const WorkTarget &target, int target_idx, const sequence *qu
 			if (config.log_extend) {
 				cout << "i_begin=" << hsp.query_range.begin_ << " j_begin=" << hsp.subject_range.begin_ << " d_min=" << hsp.d_min << " d_max=" << hsp.d_max << endl;
 			}
-			dp_targets[frame].emplace_back(target.seq, std::max(hsp.d_min - band, -(slen - 1)), std::min(hsp.d_max + 1 + band, qlen), target_idx);
+			dp_targets[frame].emplace_back(target.seq, std::max(hsp.d_min - band, -(slen - 1)), std::min(hsp.d_max + 1 + band, qlen), target_idx, hsp.score);
 		}
 	}
 }
@@ -68,6 +68,7 @@ vector<Target> align(const vector<WorkTarget> &targets, const sequence *query_se
 		r.emplace_back(targets[i].block_id, targets[i].seq, targets[i].outranked);
 	}
 
+	DpStat stat;
 	for (unsigned frame = 0; frame < align_mode.query_contexts; ++frame) {
 		if (dp_targets[frame].empty())
 			continue;
@@ -77,11 +78,13 @@ vector<Target> align(const vector<WorkTarget> &targets, const sequence *query_se
 			dp_targets[frame].end(),
 			Frame(frame),
 			config.comp_based_stats ? &query_cb[frame] : nullptr,
+			stat,
 			flags,
 			raw_score_cutoff);
 		while (!hsp.empty())
 			r[hsp.front().swipe_target].add_hit(hsp, hsp.begin());
 	}
+	dp_stat += stat;
 
 	return r;
 }
@@ -92,7 +95,7 @@ void add_dp_targets(const Target &target, int target_idx, const sequence *query_
 	for (unsigned frame = 0; frame < align_mode.query_contexts; ++frame) {
 		const int qlen = (int)query_seq[frame].length();
 		for (const Hsp &hsp : target.hsp[frame]) {
-			dp_targets[frame].emplace_back(target.seq, hsp.query_range.begin_, hsp.query_range.end_, target_idx);
+			dp_targets[frame].emplace_back(target.seq, hsp.query_range.begin_, hsp.query_range.end_, target_idx, hsp.score);
 		}
 	}
 }
@@ -115,6 +118,7 @@ vector<Match> align(vector<Target> &targets, const sequence *query_seq, const Bi
 		r.emplace_back(targets[i].block_id, targets[i].outranked);
 	}
 
+	DpStat stat;
 	for (unsigned frame = 0; frame < align_mode.query_contexts; ++frame) {
 		if (dp_targets[frame].empty())
 			continue;
@@ -124,11 +128,13 @@ vector<Match> align(vector<Target> &targets, const sequence *query_seq, const Bi
 			dp_targets[frame].end(),
 			Frame(frame),
 			config.comp_based_stats ? &query_cb[frame] : nullptr,
+			stat,
 			DP::TRACEBACK | flags,
 			0);
 		while (!hsp.empty())
 			r[hsp.front().swipe_target].add_hit(hsp, hsp.begin());
 	}
+	dp_stat += stat;
 
 	for (Match &match : r)
 		match.inner_culling(source_query_len);
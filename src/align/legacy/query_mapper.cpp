@@ -25,6 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../../output/output_format.h"
 #include "../../output/daa_write.h"
 #include "../../output/target_culling.h"
+#include "../../data/query_cache.h"
 
 using namespace std;
 
@@ -84,6 +85,8 @@ QueryMapper::QueryMapper(const Parameters &params, size_t query_id, Trace_pt_lis
 	targets_finished(0),
 	next_target(0),
 	source_query_len(get_source_query_len((unsigned)query_id)),
+	query_cb(nullptr),
+	profile(nullptr),
 	translated_query(get_translated_query(query_id)),
 	target_parallel(target_parallel),
 	metadata(metadata)
@@ -95,13 +98,24 @@ void QueryMapper::init()
 {
 	if(config.log_query)
 		cout << "Query = " << query_ids::get()[query_id].c_str() << endl;
-	if (config.comp_based_stats == 1)
-		for (unsigned i = 0; i < align_mode.query_contexts; ++i)
-			query_cb.emplace_back(query_seq(i));
-	if (config.ext == Config::greedy || config.ext == Config::more_greedy)
-		for (unsigned i = 0; i < align_mode.query_contexts; ++i)
-			profile.emplace_back(query_seq(i));
-			//profile.push_back(Long_score_profile());
+	if (config.comp_based_stats == 1) {
+		if (query_cache.enabled())
+			query_cb = query_cache.bias_correction(query_id);
+		else {
+			for (unsigned i = 0; i < align_mode.query_contexts; ++i)
+				query_cb_buf.emplace_back(query_seq(i));
+			query_cb = query_cb_buf.data();
+		}
+	}
+	if (config.ext == Config::greedy || config.ext == Config::more_greedy) {
+		if (query_cache.enabled())
+			profile = query_cache.score_profile(query_id);
+		if (!profile) {
+			for (unsigned i = 0; i < align_mode.query_contexts; ++i)
+				profile_buf.emplace_back(query_seq(i));
+			profile = profile_buf.data();
+		}
+	}
 	targets.resize(count_targets());
 	if (targets.empty())
 		return;
@@ -110,7 +124,6 @@ void QueryMapper::init()
 
 unsigned QueryMapper::count_targets()
 {
-	std::sort(source_hits.first, source_hits.second, hit::cmp_subject);
 	const size_t n = source_hits.second - source_hits.first;
 	const Trace_pt_list::iterator hits = source_hits.first;
 	size_t subject_id = std::numeric_limits<size_t>::max();
@@ -112,8 +112,9 @@ struct QueryMapper
 	unsigned source_query_len, unaligned_from;
 	PtrVector<Target> targets;
 	vector<Seed_hit> seed_hits;
-	vector<Bias_correction> query_cb;
-	vector<Long_score_profile> profile;
+	// Per query context, owned by the mapper or by the query cache.
+	const Bias_correction *query_cb;
+	const Long_score_profile *profile;
 	TranslatedSequence translated_query;
 	bool target_parallel;
 	const Metadata &metadata;
@@ -127,6 +128,9 @@ private:
 		return align_mode.query_translated ? query_source_seqs::get()[query_id] : query_seqs::get()[query_id];
 	}
 	void load_targets();
+
+	vector<Bias_correction> query_cb_buf;
+	vector<Long_score_profile> profile_buf;
 	
 };
 
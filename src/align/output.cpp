@@ -25,6 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../output/output_format.h"
 #include "../data/ref_dictionary.h"
 #include "../output/daa_write.h"
+#include "../output/output.h"
 
 using std::vector;
 
@@ -32,7 +33,7 @@ namespace Extension {
 
 TextBuffer* generate_output(vector<Match> &targets, size_t query_block_id, Statistics &stat, const Metadata &metadata, const Parameters &parameters)
 {
-	TextBuffer* out = new TextBuffer;
+	TextBuffer* out = OutputSink::get().get_buffer();
 	std::unique_ptr<Output_format> f(output_format->clone());
 	size_t seek_pos = 0;
 	unsigned n_hsp = 0, hit_hsps = 0;
@@ -52,8 +52,24 @@ struct SeedHit {
 WorkTarget ungapped_stage(const SeedHit *begin, const SeedHit *end, const sequence *query_seq, const Bias_correction *query_cb, size_t block_id) {
 	array<vector<Diagonal_segment>, MAX_CONTEXT> diagonal_segments;
 	WorkTarget target(block_id, ref_seqs::get()[block_id]);
-	for (const SeedHit *hit = begin; hit < end; ++hit)
-		diagonal_segments[hit->frame].push_back(xdrop_ungapped(query_seq[hit->frame], target.seq, hit->i, hit->j));
+	if (config.ungapped_batch) {
+		thread_local array<vector<int>, MAX_CONTEXT> qa, sa;
+		for (unsigned frame = 0; frame < align_mode.query_contexts; ++frame) {
+			qa[frame].clear();
+			sa[frame].clear();
+		}
+		for (const SeedHit *hit = begin; hit < end; ++hit) {
+			qa[hit->frame].push_back(hit->i);
+			sa[hit->frame].push_back(hit->j);
+		}
+		for (unsigned frame = 0; frame < align_mode.query_contexts; ++frame) {
+			diagonal_segments[frame].resize(qa[frame].size());
+			xdrop_ungapped_batch(query_seq[frame], target.seq, qa[frame].data(), sa[frame].data(), qa[frame].size(), diagonal_segments[frame].data());
+		}
+	}
+	else
+		for (const SeedHit *hit = begin; hit < end; ++hit)
+			diagonal_segments[hit->frame].push_back(xdrop_ungapped(query_seq[hit->frame], target.seq, hit->i, hit->j));
 	for (unsigned frame = 0; frame < align_mode.query_contexts; ++frame) {
 		if (diagonal_segments[frame].empty())
 			continue;
@@ -78,7 +94,6 @@ vector<WorkTarget> ungapped_stage(const sequence *query_seq, const Bias_correcti
 	vector<WorkTarget> targets;
 	if (begin >= end)
 		return targets;
-	std::sort(begin, end, hit::cmp_subject);
 	size_t target = SIZE_MAX;
 	thread_local FlatArray<SeedHit> hits;
 	thread_local vector<size_t> target_block_ids;
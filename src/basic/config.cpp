@@ -80,11 +80,13 @@ Config::Config(int argc, const char **argv, bool check_io)
 		.add_command("test", "")
 		.add_command("reverse", "")
 		.add_command("compute-medoids", "")
-		.add_command("mutate", "");
+		.add_command("mutate", "")
+		.add_command("makeidx", "Build a seed index for a DIAMOND database");
 
 	Options_group general("General options");
 	general.add()
 		("threads", 'p', "number of CPU threads", threads_)
+		("numa", 0, "pin threads and place reference data and seed arrays on NUMA nodes", numa)
 		("db", 'd', "database file", database)
 		("out", 'o', "output file", output_file)
 		("outfmt", 'f', "output format\n\
@@ -165,6 +167,8 @@ Config::Config(int argc, const char **argv, bool check_io)
 		("more-sensitive", 0, "enable more sensitive mode (default: fast)", mode_more_sensitive)
 		("block-size", 'b', "sequence block size in billions of letters (default=2.0)", chunk_size)
 		("index-chunks", 'c', "number of chunks for index processing", lowmem)
+		("prefetch-size", 0, "load the next reference block in the background if the block size does not exceed this value (in billions of letters, default=0=disabled)", prefetch_size)
+		("seed-index", 0, "use the seed index built by the makeidx command", seed_index)
 		("tmpdir", 't', "directory for temporary files", tmpdir)
 		("gapopen", 0, "gap open penalty", gap_open, -1)
 		("gapextend", 0, "gap extension penalty", gap_extend, -1)
@@ -191,9 +195,19 @@ Config::Config(int argc, const char **argv, bool check_io)
 	advanced.add()
 		("algo", 0, "Seed search algorithm (0=double-indexed/1=query-indexed)", algo, -1)
 		("bin", 0, "number of query bins for seed search", query_bins, 16u)
+		("bin-memory", 0, "memory for keeping seed hits in memory before using temporary files (in GB, default=auto (at most half of the available RAM), 0=temporary files only)", bin_memory, -1.0)
 		("min-orf", 'l', "ignore translated sequences without an open reading frame of at least this length", run_len)
 		("freq-sd", 0, "number of standard deviations for ignoring frequent seeds", freq_sd, 0.0)
+		("freq-prepass", 0, "count seeds and remove frequent seeds before the seed join", freq_prepass)
+		("bloom-fpr", 0, "use a Bloom filter with this false positive rate for query seed sets (default=0, exact sets)", bloom_fpr, 0.0)
+		("minimizer-window", 0, "sample reference seeds as minimizers of this window size (default=1, all seeds)", minimizer_window, (size_t)1)
 		("id2", 0, "minimum number of identities for stage 1 hit", min_identities)
+		("join-algo", 0, "seed join algorithm (0=hash join, 1=radix-partitioned hash join)", join_algo, 0u)
+		("stage2-batch", 0, "batch gapped hit verification over query positions", stage2_batch)
+		("collision-cache", 0, "precompute seed partitions and frequency of reference positions for the collision filter", collision_cache)
+		("ungapped-batch", 0, "extend the seed hits of a target in SIMD batches in the ungapped stage", ungapped_batch)
+		("traceback-memory", 0, "memory per thread for banded swipe traceback matrices before switching to a checkpointed traceback (in GB)", traceback_memory, 1.0)
+		("finger-print", 0, "finger print for stage 1 hits (0=letters, 1=4 bit reduced alphabet)", finger_print, 0u)
 		("window", 'w', "window size for local hit search", window)
 		("xdrop", 'x', "xdrop for ungapped alignment", ungapped_xdrop, 12.3)
 		("ungapped-score", 0, "minimum alignment score to continue local extension", min_ungapped_score)
@@ -278,6 +292,7 @@ Config::Config(int argc, const char **argv, bool check_io)
 		("join-split-key-len", 0, "", join_split_key_len, 17u)
 		("radix-bits", 0, "", radix_bits, 8u)
 		("join-ht-factor", 0, "", join_ht_factor, 1.3)
+		("join-cache-size", 0, "", join_cache_size, (size_t)262144)
 		("sort-join", 0, "", sort_join)
 		("simple-freq", 0, "", simple_freq)
 		("freq-treshold", 0, "", freq_treshold)
@@ -301,7 +316,11 @@ Config::Config(int argc, const char **argv, bool check_io)
 		("tantan-ungapped", 0, "use tantan masking in ungapped mode", tantan_ungapped)
 		("family-map", 0, "", family_map)
 		("chaining-range-cover", 0, "", chaining_range_cover, (size_t)8)
-		("index-mode", 0, "index mode (0=4x12, 1=16x9)", index_mode);
+		("index-mode", 0, "index mode (0=4x12, 1=16x9)", index_mode)
+		("swipe-layout", 0, "", swipe_layout, 0u)
+		("swipe-packing", 0, "", swipe_packing, 0u)
+		("query-cache", 0, "", query_cache)
+		("query-cache-memory", 0, "", query_cache_memory, 2.0);
 	
 	parser.add(general).add(makedb).add(aligner).add(advanced).add(view_options).add(getseq_options).add(hidden_options);
 	parser.store(argc, argv, command);
@@ -349,6 +368,7 @@ Config::Config(int argc, const char **argv, bool check_io)
 
 		switch (command) {
 		case Config::dbinfo:
+		case Config::makeidx:
 			if (database == "")
 				throw std::runtime_error("Missing parameter: database file (--db/-d)");
 		}
@@ -409,6 +429,7 @@ Config::Config(int argc, const char **argv, bool check_io)
 
 	switch (command) {
 	case Config::makedb:
+	case Config::makeidx:
 	case Config::blastp:
 	case Config::blastx:
 	case Config::view:
@@ -428,6 +449,7 @@ Config::Config(int argc, const char **argv, bool check_io)
 	case Config::opt:
 	case Config::mask:
 	case Config::makedb:
+	case Config::makeidx:
 	case Config::cluster:
 	case Config::regression_test:
 	case Config::compute_medoids:
@@ -483,8 +505,26 @@ Config::Config(int argc, const char **argv, bool check_io)
 		ext = swipe;
 	}
 
+	if (seed_index) {
+		if (swipe_all)
+			throw std::runtime_error("--seed-index is not supported for --swipe mode.");
+		algo = double_indexed;
+	}
+
 	use_lazy_dict = false;
 
 	if (query_range_culling && taxon_k != 0)
 		throw std::runtime_error("--taxon-k is not supported for --range-culling mode.");
 }
+
+size_t Config::trace_pt_mem_budget() const
+{
+	if (bin_memory >= 0)
+		return size_t(bin_memory * 1e9);
+	if (mem_buffered())
+		return std::numeric_limits<size_t>::max();
+	// The automatic budget is capped at half of the available physical memory, so that the seed hits go to temporary
+	// files instead of swapping when memory is short.
+	const double budget = std::min(chunk_size * 1e9 * 9 * 2 / lowmem, 10e9), available = (double)available_memory();
+	return (size_t)(available > 0 ? std::min(budget, available / 2) : budget);
+}
@@ -22,6 +22,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <string>
 #include <vector>
 #include <stdint.h>
+#include <limits>
+#include <algorithm>
 
 using std::string;
 using std::vector;
@@ -46,6 +48,8 @@ struct Config
 	unsigned compression;
 	unsigned		lowmem;
 	double	chunk_size;
+	double	prefetch_size;
+	double	bin_memory;
 	unsigned min_identities;
 	unsigned min_identities2;
 	double ungapped_xdrop;
@@ -98,6 +102,14 @@ struct Config
 	bool ht_mode;
 	bool old_freq;
 	double freq_sd;
+	bool freq_prepass;
+	size_t minimizer_window;
+	double bloom_fpr;
+	bool numa;
+	bool stage2_batch;
+	bool collision_cache;
+	bool ungapped_batch;
+	bool query_cache;
 	unsigned target_fetch_size;
 	bool mode_more_sensitive;
 	string matrix_file;
@@ -155,6 +167,9 @@ struct Config
 	unsigned join_split_key_len;
 	unsigned radix_bits;
 	double join_ht_factor;
+	size_t join_cache_size;
+	enum { join_hash = 0, join_radix_hash = 1 };
+	unsigned join_algo;
 	bool sort_join;
 	bool simple_freq;
 	double freq_treshold;
@@ -182,6 +197,7 @@ struct Config
 	bool tantan_ungapped;
 	string taxon_exclude;
 	bool swipe_all;
+	bool seed_index;
 	uint64_t taxon_k;
 	uint64_t upgma_edge_limit;
 	string tree_file;
@@ -196,16 +212,26 @@ struct Config
 		makedb = 0, blastp = 1, blastx = 2, view = 3, help = 4, version = 5, getseq = 6, benchmark = 7, random_seqs = 8, compare = 9, sort = 10, roc = 11, db_stat = 12, model_sim = 13,
 		match_file_stat = 14, model_seqs = 15, opt = 16, mask = 17, fastq2fasta = 18, dbinfo = 19, test_extra = 20, test_io = 21, db_annot_stats = 22, read_sim = 23, info = 24, seed_stat = 25,
 		smith_waterman = 26, protein_snps = 27, cluster = 28, translate = 29, filter_blasttab = 30, show_cbs = 31, simulate_seqs = 32, split = 33, upgma = 34, upgma_mc = 35, regression_test = 36,
-		reverse_seqs = 37, compute_medoids = 38, mutate = 39
+		reverse_seqs = 37, compute_medoids = 38, mutate = 39, makeidx = 40
 	};
 	unsigned	command;
 
 	enum { double_indexed = 0, query_indexed = 1, subject_indexed = 2 };
 	int algo;
 
+	enum { finger_print_bytes = 0, finger_print_reduced = 1 };
+	unsigned finger_print;
+
 	enum { query_parallel = 0, target_parallel = 1 };
 	unsigned load_balancing;
 
+	enum { swipe_layout_auto = 0, swipe_layout_inter = 1, swipe_layout_intra = 2 };
+	unsigned swipe_layout;
+	double traceback_memory;
+	double query_cache_memory;
+	enum { swipe_packing_start = 0, swipe_packing_grouped = 1 };
+	unsigned swipe_packing;
+
 	enum {
 		swipe = 0, greedy = 1, floating_xdrop = 4, more_greedy = 2, most_greedy=3, banded_swipe=4
 	};
@@ -266,6 +292,8 @@ struct Config
 
 	bool mem_buffered() const { return tmpdir == "/dev/shm"; }
 
+	size_t trace_pt_mem_budget() const;
+
   	template<typename _t>
 	static void set_option(_t& option, _t value) { if (option == 0) option = value; }
 };
@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "masking.h"
 #include "../lib/tantan/LambdaCalculator.hh"
 #include "../util/tantan.h"
+#include "../util/parallel/thread_pool.h"
 
 using namespace std;
 
@@ -77,24 +78,17 @@ void Masking::remove_bit_mask(Letter *seq, size_t len) const
 			seq[i] &= ~bit_mask;
 }
 
-void mask_worker(atomic<size_t> *next, Sequence_set *seqs, const Masking *masking, bool hard_mask)
+void mask_worker(size_t i, size_t thread_id, Sequence_set *seqs, const Masking *masking, bool hard_mask)
 {
-	size_t i;
-	while ((i = (*next)++) < seqs->get_length())
-		if (hard_mask)
-			masking->operator()(seqs->ptr(i), seqs->length(i));
-		else
-			masking->mask_bit(seqs->ptr(i), seqs->length(i));
+	if (hard_mask)
+		masking->operator()(seqs->ptr(i), seqs->length(i));
+	else
+		masking->mask_bit(seqs->ptr(i), seqs->length(i));
 }
 
-size_t mask_seqs(Sequence_set &seqs, const Masking &masking, bool hard_mask)
+size_t mask_seqs(Sequence_set &seqs, const Masking &masking, bool hard_mask, size_t thread_count)
 {
-	vector<thread> threads;
-	atomic<size_t> next(0);
-	for (size_t i = 0; i < config.threads_; ++i)
-		threads.emplace_back(mask_worker, &next, &seqs, &masking, hard_mask);
-	for (auto &t : threads)
-		t.join();
+	Util::Parallel::scheduled_thread_pool_auto(thread_count ? thread_count : config.threads_, seqs.get_length(), mask_worker, &seqs, &masking, hard_mask);
 	size_t n = 0;
 	for (size_t i = 0; i < seqs.get_length(); ++i)
 		n += std::count(seqs[i].data(), seqs[i].end(), value_traits.mask_char);
@@ -41,4 +41,5 @@ private:
 	char mask_table_x_[size], mask_table_bit_[size];
 };
 
-size_t mask_seqs(Sequence_set &seqs, const Masking &masking, bool hard_mask = true);
\ No newline at end of file
+// Masks the sequences using thread_count threads of the thread pool (0 = --threads). Returns the number of masked letters.
+size_t mask_seqs(Sequence_set &seqs, const Masking &masking, bool hard_mask = true, size_t thread_count = 0);
\ No newline at end of file
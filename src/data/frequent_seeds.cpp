@@ -34,18 +34,16 @@ using namespace std;
 const double Frequent_seeds::hash_table_factor = 1.3;
 Frequent_seeds frequent_seeds;
 
-void Frequent_seeds::compute_sd(atomic<unsigned> *seedp, DoubleArray<SeedArray::_pos> *query_seed_hits, DoubleArray<SeedArray::_pos> *ref_seed_hits, vector<Sd> *ref_out, vector<Sd> *query_out)
+void Frequent_seeds::compute_sd(size_t i, size_t thread_id, DoubleArray<SeedArray::_pos> *query_seed_hits, DoubleArray<SeedArray::_pos> *ref_seed_hits, vector<Sd> *ref_out, vector<Sd> *query_out)
 {
-	unsigned p;
-	while ((p = (*seedp)++) < current_range.end()) {
-		Sd ref_sd, query_sd;
-		for (auto it = JoinIterator<SeedArray::_pos>(query_seed_hits[p].begin(), ref_seed_hits[p].begin()); it; ++it) {
-			query_sd.add((double)it.r->size());
-			ref_sd.add((double)it.s->size());
-		}
-		(*ref_out)[p - current_range.begin()] = ref_sd;
-		(*query_out)[p - current_range.begin()] = query_sd;
+	const unsigned p = current_range.begin() + (unsigned)i;
+	Sd ref_sd, query_sd;
+	for (auto it = JoinIterator<SeedArray::_pos>(query_seed_hits[p].begin(), ref_seed_hits[p].begin()); it; ++it) {
+		query_sd.add((double)it.r->size());
+		ref_sd.add((double)it.s->size());
 	}
+	(*ref_out)[i] = ref_sd;
+	(*query_out)[i] = query_sd;
 }
 
 void Frequent_seeds::build_worker(
@@ -95,12 +93,7 @@ void Frequent_seeds::build_worker(
 void Frequent_seeds::build(unsigned sid, const SeedPartitionRange &range, DoubleArray<SeedArray::_pos> *query_seed_hits, DoubleArray<SeedArray::_pos> *ref_seed_hits)
 {
 	vector<Sd> ref_sds(range.size()), query_sds(range.size());
-	atomic<unsigned> seedp(range.begin());
-	vector<thread> threads;
-	for (unsigned i = 0; i < config.threads_; ++i)
-		threads.emplace_back(compute_sd, &seedp, query_seed_hits, ref_seed_hits, &ref_sds, &query_sds);
-	for (auto &t : threads)
-		t.join();
+	Util::Parallel::scheduled_thread_pool_auto(config.threads_, range.size(), compute_sd, query_seed_hits, ref_seed_hits, &ref_sds, &query_sds);
 
 	Sd ref_sd(ref_sds), query_sd(query_sds);
 	const unsigned ref_max_n = (unsigned)(ref_sd.mean() + config.freq_sd*ref_sd.sd()), query_max_n = (unsigned)(query_sd.mean() + config.freq_sd*query_sd.sd());
@@ -110,4 +103,96 @@ void Frequent_seeds::build(unsigned sid, const SeedPartitionRange &range, Double
 	vector<unsigned> counts(Const::seedp);
 	Util::Parallel::scheduled_thread_pool_auto(config.threads_, Const::seedp, build_worker, query_seed_hits, ref_seed_hits, &range, sid, ref_max_n, query_max_n, &counts);
 	log_stream << "Masked positions = " << std::accumulate(counts.begin(), counts.end(), 0) << std::endl;
-}
\ No newline at end of file
+}
+void Frequent_seeds::count_seeds(CountTable &table, const SeedArray *query_seeds, const SeedArray *ref_seeds, unsigned p)
+{
+	for (const SeedArray::Entry *i = query_seeds->begin(p); i < query_seeds->begin(p) + query_seeds->size(p); ++i)
+		++table.insert(i->key)->r;
+	CountTable::Entry *e;
+	for (const SeedArray::Entry *i = ref_seeds->begin(p); i < ref_seeds->begin(p) + ref_seeds->size(p); ++i)
+		if ((e = table.find_entry(i->key)))
+			++e->s;
+}
+
+void Frequent_seeds::prepass_sd_worker(size_t i, size_t thread_id, const SeedArray *query_seeds, const SeedArray *ref_seeds, const SeedPartitionRange *range, vector<unique_ptr<CountTable>> *tables, vector<Sd> *ref_out, vector<Sd> *query_out)
+{
+	const unsigned p = range->begin() + (unsigned)i;
+	Sd ref_sd, query_sd;
+	if (query_seeds->size(p) > 0) {
+		const uint32_t N = (uint32_t)next_power_of_2(query_seeds->size(p) * config.join_ht_factor);
+		CountTable &table = *((*tables)[i] = unique_ptr<CountTable>(new CountTable(N, ExtractBits(N, 0))));
+		count_seeds(table, query_seeds, ref_seeds, p);
+		for (const CountTable::Entry *e = table.data(); e < table.data() + table.size(); ++e)
+			if (e->s) {
+				query_sd.add((double)e->r);
+				ref_sd.add((double)e->s);
+			}
+	}
+	(*ref_out)[i] = ref_sd;
+	(*query_out)[i] = query_sd;
+}
+
+void Frequent_seeds::prepass_mask_worker(
+	size_t i,
+	size_t thread_id,
+	SeedArray *query_seeds,
+	SeedArray *ref_seeds,
+	const SeedPartitionRange *range,
+	vector<unique_ptr<CountTable>> *tables,
+	unsigned sid,
+	unsigned ref_max_n,
+	unsigned query_max_n,
+	vector<unsigned> *counts)
+{
+	const unsigned p = range->begin() + (unsigned)i;
+	vector<uint32_t> buf;
+	size_t n = 0;
+	if (query_seeds->size(p) > 0) {
+		// The counts of the partition were computed by prepass_sd_worker.
+		CountTable &table = *(*tables)[i];
+		for (CountTable::Entry *e = table.data(); e < table.data() + table.size(); ++e)
+			if (e->s && (e->s > ref_max_n || e->r > query_max_n)) {
+				buf.push_back(e->key);
+				n += e->s;
+			}
+			else
+				e->s = 0;
+
+		if (!buf.empty()) {
+			SeedArray *arrays[] = { query_seeds, ref_seeds };
+			for (SeedArray *a : arrays) {
+				SeedArray::Entry *begin = a->begin(p), *end = std::remove_if(begin, begin + a->size(p), [&table](const SeedArray::Entry &x) {
+					const CountTable::Entry *e = table.find_entry(x.key);
+					return e && e->s;
+				});
+				a->set_size(p, end - begin);
+			}
+		}
+		(*tables)[i].reset();
+	}
+
+	const size_t ht_size = std::max((size_t)(buf.size() * hash_table_factor), buf.size() + 1);
+	PHash_set<void, murmur_hash> hash_set(ht_size);
+	for (vector<uint32_t>::const_iterator j = buf.begin(); j != buf.end(); ++j)
+		hash_set.insert(*j);
+
+	frequent_seeds.tables_[sid][p] = move(hash_set);
+	(*counts)[p] = (unsigned)n;
+}
+
+void Frequent_seeds::build_prepass(unsigned sid, const SeedPartitionRange &range, SeedArray *query_seeds, SeedArray *ref_seeds)
+{
+	vector<Sd> ref_sds(range.size()), query_sds(range.size());
+	// The per-partition count tables are kept from the SD pass for the masking pass.
+	vector<unique_ptr<CountTable>> tables(range.size());
+	Util::Parallel::scheduled_thread_pool_auto(config.threads_, range.size(), prepass_sd_worker, query_seeds, ref_seeds, &range, &tables, &ref_sds, &query_sds);
+
+	Sd ref_sd(ref_sds), query_sd(query_sds);
+	const unsigned ref_max_n = (unsigned)(ref_sd.mean() + config.freq_sd*ref_sd.sd()), query_max_n = (unsigned)(query_sd.mean() + config.freq_sd*query_sd.sd());
+	log_stream << "Seed frequency mean (reference) = " << ref_sd.mean() << ", SD = " << ref_sd.sd() << endl;
+	log_stream << "Seed frequency mean (query) = " << query_sd.mean() << ", SD = " << query_sd.sd() << endl;
+	log_stream << "Seed frequency cap query: " << query_max_n << ", reference: " << ref_max_n << endl;
+	vector<unsigned> counts(Const::seedp);
+	Util::Parallel::scheduled_thread_pool_auto(config.threads_, range.size(), prepass_mask_worker, query_seeds, ref_seeds, &range, &tables, sid, ref_max_n, query_max_n, &counts);
+	log_stream << "Masked positions = " << std::accumulate(counts.begin(), counts.end(), 0) << std::endl;
+}
@@ -20,16 +20,21 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define FREQUENT_SEEDS_H_
 
 #include <atomic>
+#include <memory>
 #include "../basic/const.h"
 #include "../util/hash_table.h"
 #include "seed_array.h"
 #include "../util/algo/join_result.h"
+#include "../util/algo/hash_join.h"
 #include "../util/range.h"
 
 struct Frequent_seeds
 {
 
 	void build(unsigned sid, const SeedPartitionRange &range, DoubleArray<SeedArray::_pos> *query_seed_hits, DoubleArray<SeedArray::_pos> *ref_seed_hits);
+	// Alternative to build() that runs before the join: seeds are counted exactly per partition and the entries of
+	// frequent seeds are removed from the seed arrays, so they are never joined.
+	void build_prepass(unsigned sid, const SeedPartitionRange &range, SeedArray *query_seeds, SeedArray *ref_seeds);
 
 	bool get(const Letter *pos, unsigned sid) const
 	{
@@ -55,7 +60,25 @@ private:
 		unsigned query_max_n,
 		vector<unsigned> *counts);
 
-	static void compute_sd(std::atomic<unsigned> *seedp, DoubleArray<SeedArray::_pos> *query_seed_hits, DoubleArray<SeedArray::_pos> *ref_seed_hits, vector<Sd> *ref_out, vector<Sd> *query_out);
+	typedef HashTable<unsigned, RelPtr, ExtractBits> CountTable;
+
+	static void count_seeds(CountTable &table, const SeedArray *query_seeds, const SeedArray *ref_seeds, unsigned p);
+
+	static void prepass_sd_worker(size_t i, size_t thread_id, const SeedArray *query_seeds, const SeedArray *ref_seeds, const SeedPartitionRange *range, vector<std::unique_ptr<CountTable>> *tables, vector<Sd> *ref_out, vector<Sd> *query_out);
+
+	static void prepass_mask_worker(
+		size_t i,
+		size_t thread_id,
+		SeedArray *query_seeds,
+		SeedArray *ref_seeds,
+		const SeedPartitionRange *range,
+		vector<std::unique_ptr<CountTable>> *tables,
+		unsigned sid,
+		unsigned ref_max_n,
+		unsigned query_max_n,
+		vector<unsigned> *counts);
+
+	static void compute_sd(size_t i, size_t thread_id, DoubleArray<SeedArray::_pos> *query_seed_hits, DoubleArray<SeedArray::_pos> *ref_seed_hits, vector<Sd> *ref_out, vector<Sd> *query_out);
 
 	PHash_set<void,murmur_hash> tables_[Const::max_shapes][Const::seedp];
 
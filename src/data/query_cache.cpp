@@ -0,0 +1,73 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+                        Eberhard Karls Universitaet Tuebingen
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include "query_cache.h"
+#include "queries.h"
+
+using std::vector;
+
+Query_cache query_cache;
+
+void Query_cache::init(size_t query_count)
+{
+	data_.clear();
+	data_.resize(query_count);
+	profile_memory_ = 0;
+	profile_memory_limit_ = size_t(config.query_cache_memory * 1e9);
+}
+
+void Query_cache::clear()
+{
+	vector<std::unique_ptr<Entry>>().swap(data_);
+}
+
+Query_cache::Entry& Query_cache::get(size_t query_id)
+{
+	std::unique_ptr<Entry> &e = data_[query_id];
+	if (!e)
+		e.reset(new Entry());
+	return *e;
+}
+
+const Bias_correction* Query_cache::bias_correction(size_t query_id)
+{
+	Entry &e = get(query_id);
+	if (e.cb.empty())
+		for (unsigned i = 0; i < align_mode.query_contexts; ++i)
+			e.cb.emplace_back(query_seqs::get()[query_id*align_mode.query_contexts + i]);
+	return e.cb.data();
+}
+
+const Long_score_profile* Query_cache::score_profile(size_t query_id)
+{
+	Entry &e = get(query_id);
+	if (e.profile.empty()) {
+		size_t size = 0;
+		for (unsigned i = 0; i < align_mode.query_contexts; ++i)
+			size += (query_seqs::get()[query_id*align_mode.query_contexts + i].length() + 2 * Long_score_profile::padding) * AMINO_ACID_COUNT;
+		if (profile_memory_.fetch_add(size, std::memory_order_relaxed) + size > profile_memory_limit_) {
+			profile_memory_.fetch_sub(size, std::memory_order_relaxed);
+			return nullptr;
+		}
+		for (unsigned i = 0; i < align_mode.query_contexts; ++i)
+			e.profile.emplace_back(query_seqs::get()[query_id*align_mode.query_contexts + i]);
+	}
+	return e.profile.data();
+}
@@ -0,0 +1,69 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+                        Eberhard Karls Universitaet Tuebingen
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#ifndef QUERY_CACHE_H_
+#define QUERY_CACHE_H_
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include "../dp/comp_based_stats.h"
+#include "../dp/score_profile.h"
+
+/* Query side state of the extension stage kept for a query chunk (--query-cache). The composition based bias
+corrections and greedy score profiles of the query contexts only depend on the query, but are needed again for every
+reference block. They are computed when a query is first extended and reused for the following blocks. A query is
+extended by one thread per block, so the entries are filled without locking. The score profiles take about 26 bytes per
+letter and context and are only kept up to --query-cache-memory in total; beyond that, score_profile() returns nullptr
+and the caller builds its own profile. */
+struct Query_cache
+{
+
+	void init(size_t query_count);
+	void clear();
+
+	bool enabled() const
+	{
+		return !data_.empty();
+	}
+
+	const Bias_correction* bias_correction(size_t query_id);
+	// Returns nullptr if the profile does not fit into the memory limit.
+	const Long_score_profile* score_profile(size_t query_id);
+
+private:
+
+	struct Entry
+	{
+		std::vector<Bias_correction> cb;
+		std::vector<Long_score_profile> profile;
+	};
+
+	Entry& get(size_t query_id);
+
+	std::vector<std::unique_ptr<Entry>> data_;
+	std::atomic<size_t> profile_memory_;
+	size_t profile_memory_limit_;
+
+};
+
+extern Query_cache query_cache;
+
+#endif
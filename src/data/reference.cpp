@@ -270,13 +270,14 @@ void DatabaseFile::seek_direct() {
 	seek(sizeof(ReferenceHeader) + sizeof(ReferenceHeader2) + 8);
 }
 
-bool DatabaseFile::load_seqs(vector<unsigned> &block_to_database_id, size_t max_letters, Sequence_set **dst_seq, String_set<0> **dst_id, bool load_ids, const vector<bool> *filter)
+bool DatabaseFile::load_seqs(vector<unsigned> &block_to_database_id, size_t max_letters, Sequence_set **dst_seq, String_set<0> **dst_id, bool load_ids, const vector<bool> *filter, bool *blocked)
 {
-	task_timer timer("Loading reference sequences");
+	task_timer timer("Loading reference sequences", blocked ? UINT_MAX : 1);
 	seek(pos_array_offset);
 	size_t database_id = tell_seq();
 	size_t letters = 0, seqs = 0, id_letters = 0, seqs_processed = 0;
-	vector<uint64_t> filtered_pos;
+	// File range [begin, end) of the record (sequence and title) of each loaded sequence.
+	vector<std::pair<uint64_t, uint64_t>> records;
 	block_to_database_id.clear();
 
 	*dst_seq = new Sequence_set;
@@ -284,8 +285,6 @@ bool DatabaseFile::load_seqs(vector<unsigned> &block_to_database_id, size_t max_
 
 	Pos_record r;
 	read(&r, 1);
-	uint64_t start_offset = r.pos;
-	bool last = false;
 
 	while (r.seq_len > 0 && letters < max_letters) {
 		Pos_record r_next;
@@ -298,11 +297,8 @@ bool DatabaseFile::load_seqs(vector<unsigned> &block_to_database_id, size_t max_
 			if (load_ids) (*dst_id)->reserve(id_len);
 			++seqs;
 			block_to_database_id.push_back((unsigned)database_id);
-			if (filter) filtered_pos.push_back(last ? 0 : r.pos);
-			last = true;
+			records.emplace_back(r.pos, r_next.pos);
 		}
-		else
-			last = false;
 		pos_array_offset += sizeof(Pos_record);
 		++database_id;
 		++seqs_processed;
@@ -319,25 +315,40 @@ bool DatabaseFile::load_seqs(vector<unsigned> &block_to_database_id, size_t max_
 
 	(*dst_seq)->finish_reserve();
 	if(load_ids) (*dst_id)->finish_reserve();
-	seek(start_offset);
-
-	for (size_t n = 0; n < seqs; ++n) {
-		if (filter && filtered_pos[n]) seek(filtered_pos[n]);
-		read((*dst_seq)->ptr(n) - 1, (*dst_seq)->length(n) + 2);
-		*((*dst_seq)->ptr(n) - 1) = sequence::DELIMITER;
-		*((*dst_seq)->ptr(n) + (*dst_seq)->length(n)) = sequence::DELIMITER;
-		if (load_ids)
-			read((*dst_id)->ptr(n), (*dst_id)->length(n) + 1);
-		else
-			if (!seek_forward('\0')) throw std::runtime_error("Unexpected end of file.");
-		Masking::get().remove_bit_mask((*dst_seq)->ptr(n), (*dst_seq)->length(n));
-		if (!config.sfilt.empty() && strstr((**dst_id)[n].c_str(), config.sfilt.c_str()) == 0)
-			memset((*dst_seq)->ptr(n), value_traits.mask_char, (*dst_seq)->length(n));
+
+	// Consecutive records are read with one bulk read of up to MAX_READ bytes and then split into the sequences and
+	// titles in memory.
+	static const uint64_t MAX_READ = 1llu << 26;
+	vector<char> buf;
+	for (size_t n = 0; n < seqs;) {
+		size_t m = n + 1;
+		while (m < seqs && records[m].first == records[m - 1].second && records[m].second - records[n].first <= MAX_READ)
+			++m;
+		const size_t size = records[m - 1].second - records[n].first;
+		buf.resize(size);
+		seek(records[n].first);
+		if (read_bulk(buf.data(), size) != size)
+			throw std::runtime_error("Unexpected end of file.");
+		for (const char *p = buf.data(); n < m; ++n) {
+			const size_t len = (*dst_seq)->length(n);
+			std::copy(p + 1, p + 1 + len, (*dst_seq)->ptr(n));
+			*((*dst_seq)->ptr(n) - 1) = sequence::DELIMITER;
+			*((*dst_seq)->ptr(n) + len) = sequence::DELIMITER;
+			if (load_ids)
+				std::copy(p + len + 2, p + len + 3 + (*dst_id)->length(n), (*dst_id)->ptr(n));
+			p += records[n].second - records[n].first;
+			Masking::get().remove_bit_mask((*dst_seq)->ptr(n), len);
+			if (!config.sfilt.empty() && strstr((**dst_id)[n].c_str(), config.sfilt.c_str()) == 0)
+				memset((*dst_seq)->ptr(n), value_traits.mask_char, len);
+		}
 	}
 	timer.finish();
-	(*dst_seq)->print_stats();
-
-	blocked_processing = seqs_processed < ref_header.sequences;
+	if (blocked)
+		*blocked = seqs_processed < ref_header.sequences;
+	else {
+		(*dst_seq)->print_stats();
+		blocked_processing = seqs_processed < ref_header.sequences;
+	}
 	return true;
 }
 
@@ -19,12 +19,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdint.h>
 #include "seed_array.h"
 #include "seed_set.h"
+#include "../util/system/numa.h"
 
 typedef vector<Array<SeedArray::Entry*, Const::seedp> > PtrSet;
 
 char* SeedArray::alloc_buffer(const Partitioned_histogram &hst)
 {
-	return new char[sizeof(Entry) * hst.max_chunk_size()];
+	const size_t size = sizeof(Entry) * hst.max_chunk_size();
+	char *buffer = new char[size];
+	// Seed partitions are processed in contiguous slices by the pool threads, so the buffer is split the same way over the NUMA nodes.
+	Numa::distribute(buffer, size);
+	return buffer;
 }
 
 struct BufferedWriter
@@ -97,20 +102,23 @@ struct BuildCallback
 };
 
 template<typename _filter>
-SeedArray::SeedArray(const Sequence_set &seqs, size_t shape, const shape_histogram &hst, const SeedPartitionRange &range, const vector<size_t> &seq_partition, char *buffer, const _filter *filter) :
+SeedArray::SeedArray(const Sequence_set &seqs, size_t shape, const shape_histogram &hst, const SeedPartitionRange &range, const vector<size_t> &seq_partition, char *buffer, const _filter *filter, size_t minimizer_window) :
 	data_((Entry*)buffer)
 {
 	begin_[range.begin()] = 0;
-	for (size_t i = range.begin(); i < range.end(); ++i)
+	for (size_t i = range.begin(); i < range.end(); ++i) {
 		begin_[i + 1] = begin_[i] + partition_size(hst, i);
+		size_[i] = begin_[i + 1] - begin_[i];
+	}
 
 	PtrSet iterators(build_iterators(*this, hst));
 	PtrVector<BuildCallback> cb;
 	for (size_t i = 0; i < seq_partition.size() - 1; ++i)
 		cb.push_back(new BuildCallback(range, iterators[i].begin()));
-	seqs.enum_seeds(cb, seq_partition, shape, shape + 1, filter);
+	seqs.enum_seeds(cb, seq_partition, shape, shape + 1, filter, minimizer_window);
 }
 
-template SeedArray::SeedArray(const Sequence_set &, size_t, const shape_histogram &, const SeedPartitionRange &, const vector<size_t>&, char *buffer, const No_filter *);
-template SeedArray::SeedArray(const Sequence_set &, size_t, const shape_histogram &, const SeedPartitionRange &, const vector<size_t>&, char *buffer, const Seed_set *);
-template SeedArray::SeedArray(const Sequence_set &, size_t, const shape_histogram &, const SeedPartitionRange &, const vector<size_t>&, char *buffer, const Hashed_seed_set *);
\ No newline at end of file
+template SeedArray::SeedArray(const Sequence_set &, size_t, const shape_histogram &, const SeedPartitionRange &, const vector<size_t>&, char *buffer, const No_filter *, size_t);
+template SeedArray::SeedArray(const Sequence_set &, size_t, const shape_histogram &, const SeedPartitionRange &, const vector<size_t>&, char *buffer, const Seed_set *, size_t);
+template SeedArray::SeedArray(const Sequence_set &, size_t, const shape_histogram &, const SeedPartitionRange &, const vector<size_t>&, char *buffer, const Hashed_seed_set *, size_t);
+template SeedArray::SeedArray(const Sequence_set &, size_t, const shape_histogram &, const SeedPartitionRange &, const vector<size_t>&, char *buffer, const Bloom_seed_set *, size_t);
\ No newline at end of file
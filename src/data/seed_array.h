@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef SEED_ARRAY_H_
 #define SEED_ARRAY_H_
 
+#include <algorithm>
 #include "seed_histogram.h"
 #include "../basic/packed_loc.h"
 
@@ -45,7 +46,16 @@ struct SeedArray
 	} PACKED_ATTRIBUTE;
 
 	template<typename _filter>
-	SeedArray(const Sequence_set &seqs, size_t shape, const shape_histogram &hst, const SeedPartitionRange &range, const vector<size_t> &seq_partition, char *buffer, const _filter *filter);
+	SeedArray(const Sequence_set &seqs, size_t shape, const shape_histogram &hst, const SeedPartitionRange &range, const vector<size_t> &seq_partition, char *buffer, const _filter *filter, size_t minimizer_window = 1);
+
+	// Seed array over existing data covering all partitions (e.g. loaded from a seed index).
+	SeedArray(Entry *data, const uint64_t *partition_begin) :
+		data_(data)
+	{
+		std::copy(partition_begin, partition_begin + Const::seedp + 1, begin_);
+		for (unsigned i = 0; i < Const::seedp; ++i)
+			size_[i] = begin_[i + 1] - begin_[i];
+	}
 
 	Entry* begin(unsigned i)
 	{
@@ -59,7 +69,13 @@ struct SeedArray
 
 	size_t size(size_t i) const
 	{
-		return begin_[i + 1] - begin_[i];
+		return size_[i];
+	}
+
+	// Shrinks partition i to its first n entries.
+	void set_size(size_t i, size_t n)
+	{
+		size_[i] = n;
 	}
 
 	static char *alloc_buffer(const Partitioned_histogram &hst);
@@ -67,7 +83,7 @@ struct SeedArray
 private:
 
 	Entry *data_;
-	size_t begin_[Const::seedp + 1];
+	size_t begin_[Const::seedp + 1], size_[Const::seedp];
 
 };
 
@@ -87,7 +87,7 @@ struct Partitioned_histogram
 	Partitioned_histogram();
 	
 	template<typename _filter>
-	Partitioned_histogram(const Sequence_set &seqs, bool serial, const _filter *filter) :
+	Partitioned_histogram(const Sequence_set &seqs, bool serial, const _filter *filter, size_t minimizer_window = 1) :
 		data_(shapes.count()),
 		p_(seqs.partition(config.threads_))
 	{
@@ -98,9 +98,9 @@ struct Partitioned_histogram
 			cb.push_back(new Callback(i, data_));
 		if (serial)
 			for (unsigned s = 0; s < shapes.count(); ++s)
-				seqs.enum_seeds(cb, p_, s, s + 1, filter);
+				seqs.enum_seeds(cb, p_, s, s + 1, filter, minimizer_window);
 		else
-			seqs.enum_seeds(cb, p_, 0, shapes.count(), filter);
+			seqs.enum_seeds(cb, p_, 0, shapes.count(), filter, minimizer_window);
 	}
 
 	const shape_histogram& get(unsigned sid) const
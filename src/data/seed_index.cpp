@@ -0,0 +1,205 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <sstream>
+#include <stdexcept>
+#include "seed_index.h"
+#include "reference.h"
+#include "../basic/config.h"
+#include "../basic/masking.h"
+#include "../search/search.h"
+#include "../util/io/output_file.h"
+#include "../util/io/input_file.h"
+#include "../util/log_stream.h"
+
+using std::string;
+using std::vector;
+using std::runtime_error;
+using std::endl;
+
+constexpr uint64_t SeedIndexHeader::MAGIC_NUMBER;
+
+static const char* const FORMAT_ERROR = "Seed index file is invalid or outdated. Please rebuild it using the makeidx command.";
+
+SeedIndex::SeedIndex(const string &file_name) :
+	file_name_(file_name),
+	block_(0)
+{
+	InputFile f(file_name);
+	if (f.read(&header_, 1) != 1 || header_.magic_number != SeedIndexHeader::MAGIC_NUMBER || header_.version != SeedIndexHeader::CURRENT_VERSION)
+		throw runtime_error(FORMAT_ERROR);
+	f >> params_;
+	f.seek(header_.directory_offset);
+	blocks_.resize(header_.blocks);
+	offsets_.resize((size_t)header_.blocks * header_.shapes);
+	for (uint32_t i = 0; i < header_.blocks; ++i) {
+		f.read(blocks_[i]);
+		if (f.read(&offsets_[i * header_.shapes], header_.shapes) != header_.shapes)
+			throw runtime_error(FORMAT_ERROR);
+	}
+	f.close();
+}
+
+void SeedIndex::check(const DatabaseFile &db) const
+{
+	if (memcmp(header_.db_hash, db.header2.hash, sizeof(header_.db_hash)) != 0
+		|| header_.sequences != db.ref_header.sequences
+		|| header_.letters != db.ref_header.letters)
+		throw runtime_error("Seed index " + file_name_ + " was not built for this database.");
+	if (header_.block_size != (uint64_t)(config.chunk_size * 1e9))
+		throw runtime_error("Seed index " + file_name_ + " was built for a different block size (--block-size/-b).");
+}
+
+void SeedIndex::map_block(unsigned block, const Sequence_set &ref_seqs)
+{
+	if (header_.shapes != shapes.count() || params_ != params())
+		throw runtime_error("Seed index " + file_name_ + " was built for different search parameters (sensitivity mode, shapes, masking or scoring matrix).");
+	if (block >= header_.blocks || blocks_[block].sequences != ref_seqs.get_length() || blocks_[block].letters != ref_seqs.letters())
+		throw runtime_error("Seed index " + file_name_ + " does not match the reference blocks.");
+	map_.reset(new MappedFile(file_name_, true));
+	block_ = block;
+}
+
+void SeedIndex::unmap()
+{
+	map_.reset();
+}
+
+SeedArray* SeedIndex::seed_array(unsigned shape) const
+{
+	char *p = map_->data() + offsets_[block_ * header_.shapes + shape];
+	const uint64_t *partition_begin = (const uint64_t*)p;
+	return new SeedArray((SeedArray::Entry*)(p + sizeof(uint64_t) * (Const::seedp + 1)), partition_begin);
+}
+
+string SeedIndex::file_name(const string &database)
+{
+	return database + ".sidx";
+}
+
+string SeedIndex::params()
+{
+	std::stringstream ss;
+	ss << "shapes=" << shapes << " reduction=" << Reduction::reduction << " hashed=" << config.hashed_seeds
+		<< " masking=" << config.masking << " matrix=" << config.matrix << config.matrix_file;
+	if (config.minimizer_window > 1)
+		ss << " minimizer_window=" << config.minimizer_window;
+	return ss.str();
+}
+
+static void pad(OutputFile &out)
+{
+	static const char zero[8] = { 0 };
+	const size_t n = out.tell() % 8;
+	if (n != 0)
+		out.write(zero, 8 - n);
+}
+
+void make_seed_index()
+{
+	task_timer total;
+	task_timer timer("Opening the database", true);
+	DatabaseFile db(config.database);
+	timer.finish();
+
+	// The index stores the seed arrays of the double-indexed search, for the block size of the search.
+	config.algo = Config::double_indexed;
+	if (config.mode_very_sensitive)
+		Config::set_option(config.chunk_size, 0.4);
+	else
+		Config::set_option(config.chunk_size, 2.0);
+	setup_search();
+
+	const string file_name = SeedIndex::file_name(config.database);
+	message_stream << "Seed index file: " << file_name << endl;
+	message_stream << "Block size = " << (size_t)(config.chunk_size * 1e9) << endl;
+
+	OutputFile out(file_name);
+	SeedIndexHeader header;
+	memcpy(header.db_hash, db.header2.hash, sizeof(header.db_hash));
+	header.sequences = db.ref_header.sequences;
+	header.letters = db.ref_header.letters;
+	header.block_size = (uint64_t)(config.chunk_size * 1e9);
+	header.shapes = shapes.count();
+	out.write(&header, 1);
+	out << SeedIndex::params();
+	pad(out);
+
+	vector<uint64_t> directory;
+	vector<unsigned> block_to_database_id;
+	Sequence_set *seqs;
+	String_set<0> *ids;
+	uint64_t entries = 0;
+
+	try {
+		for (; db.load_seqs(block_to_database_id, (size_t)(config.chunk_size * 1e9), &seqs, &ids, false); ++header.blocks) {
+			if (config.masking == 1) {
+				timer.go("Masking reference");
+				mask_seqs(*seqs, Masking::get());
+			}
+
+			timer.go("Building reference histograms");
+			const Partitioned_histogram hst(*seqs, false, &no_filter, config.minimizer_window);
+			directory.push_back(seqs->get_length());
+			directory.push_back(seqs->letters());
+
+			timer.go("Allocating buffers");
+			size_t buffer_size = 0;
+			for (unsigned i = 0; i < shapes.count(); ++i)
+				buffer_size = std::max(buffer_size, hst_size(hst.get(i), SeedPartitionRange::all()));
+			char *buffer = new char[sizeof(SeedArray::Entry) * buffer_size];
+
+			for (unsigned i = 0; i < shapes.count(); ++i) {
+				timer.go("Building reference seed array");
+				const SeedArray seed_array(*seqs, i, hst.get(i), SeedPartitionRange::all(), hst.partition(), buffer, &no_filter, config.minimizer_window);
+				timer.go("Writing seed array");
+				directory.push_back(out.tell());
+				uint64_t partition_begin[Const::seedp + 1];
+				partition_begin[0] = 0;
+				for (unsigned p = 0; p < Const::seedp; ++p)
+					partition_begin[p + 1] = partition_begin[p] + seed_array.size(p);
+				out.write(partition_begin, Const::seedp + 1);
+				out.write(seed_array.begin(0), partition_begin[Const::seedp]);
+				pad(out);
+				entries += partition_begin[Const::seedp];
+			}
+
+			timer.go("Deallocating buffers");
+			delete[] buffer;
+			delete seqs;
+			timer.finish();
+		}
+	}
+	catch (std::exception&) {
+		out.close();
+		out.remove();
+		throw;
+	}
+
+	timer.go("Writing trailer");
+	header.directory_offset = out.tell();
+	out.write_raw(directory);
+	out.seek(0);
+	out.write(&header, 1);
+	out.close();
+	timer.finish();
+
+	message_stream << "Reference blocks = " << header.blocks << endl;
+	message_stream << "Seed entries = " << entries << endl;
+	message_stream << "Total time = " << total.get() << "s" << endl;
+}
@@ -0,0 +1,95 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#ifndef SEED_INDEX_H_
+#define SEED_INDEX_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include "seed_array.h"
+#include "../util/io/mapped_file.h"
+
+struct DatabaseFile;
+
+struct SeedIndexHeader
+{
+	SeedIndexHeader() :
+		magic_number(MAGIC_NUMBER),
+		build(Const::build_version),
+		version(CURRENT_VERSION),
+		sequences(0),
+		letters(0),
+		block_size(0),
+		blocks(0),
+		shapes(0),
+		directory_offset(0)
+	{
+		memset(db_hash, 0, sizeof(db_hash));
+	}
+	uint64_t magic_number;
+	uint32_t build, version;
+	char db_hash[16];
+	uint64_t sequences, letters, block_size;
+	uint32_t blocks, shapes;
+	uint64_t directory_offset;
+	enum { CURRENT_VERSION = 1 };
+	static constexpr uint64_t MAGIC_NUMBER = 0x7e3a5c19d40b86f2llu;
+};
+
+/* Precomputed reference seed arrays of a database, built by the makeidx command and stored next
+to the database file. The file contains one seed array per reference block and shape, each
+consisting of the partition offsets (Const::seedp + 1 values) followed by the entries. */
+
+struct SeedIndex
+{
+
+	SeedIndex(const std::string &file_name);
+	// Checks that the index was built for this database and the current block size.
+	void check(const DatabaseFile &db) const;
+	// Maps the seed arrays of a reference block. The mapping is copy-on-write since the hash join
+	// works in place, so it has to be renewed for every query block.
+	void map_block(unsigned block, const Sequence_set &ref_seqs);
+	void unmap();
+	SeedArray* seed_array(unsigned shape) const;
+
+	static std::string file_name(const std::string &database);
+	// Identifies the search parameters that the seed arrays depend on.
+	static std::string params();
+
+private:
+
+	struct BlockInfo
+	{
+		uint64_t sequences, letters;
+	};
+
+	const std::string file_name_;
+	SeedIndexHeader header_;
+	std::string params_;
+	std::vector<BlockInfo> blocks_;
+	std::vector<uint64_t> offsets_;
+	std::unique_ptr<MappedFile> map_;
+	unsigned block_;
+
+};
+
+void make_seed_index();
+
+#endif
@@ -0,0 +1,84 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+                        Eberhard Karls Universitaet Tuebingen
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include "seed_partition_cache.h"
+#include "frequent_seeds.h"
+#include "../search/seed_complexity.h"
+#include "../util/parallel/thread_pool.h"
+
+using std::vector;
+
+Seed_partition_cache seed_partition_cache;
+
+static const size_t block_size = 1 << 20;
+
+// Same seed computation as in the collision filter. The chunk checks there also use the partition of seeds that
+// set_seed() does not complete, so it is stored for invalid seeds as well.
+static inline bool set_seed(Packed_seed &seed, const Letter *pos, unsigned sid)
+{
+	return config.algo == Config::double_indexed ? shapes[sid].set_seed(seed, pos) : shapes[sid].set_seed_shifted(seed, pos);
+}
+
+void Seed_partition_cache::build_worker(size_t i, size_t thread_id, unsigned sid, uint16_t *out)
+{
+	const size_t begin = i * block_size, end = std::min(begin + block_size, ref_seqs::data_->raw_len());
+	const Letter *seq = ref_seqs::data_->data();
+	Packed_seed seed;
+	for (size_t p = begin; p < end; ++p) {
+		const bool valid = set_seed(seed, seq + p, sid);
+		uint16_t e = (uint16_t)seed_partition(seed);
+		if (!valid || (config.simple_freq && !SeedComplexity::complex(seq + p, shapes[sid])))
+			e |= HIGH_FREQUENCY;
+		out[p] = e;
+	}
+}
+
+void Seed_partition_cache::update_worker(size_t i, size_t thread_id, unsigned sid, const SeedPartitionRange *range, uint16_t *out)
+{
+	const size_t begin = i * block_size, end = std::min(begin + block_size, ref_seqs::data_->raw_len());
+	const Letter *seq = ref_seqs::data_->data();
+	for (size_t p = begin; p < end; ++p)
+		if (!high_frequency(out[p]) && range->contains(partition(out[p])) && frequent_seeds.get(seq + p, sid))
+			out[p] |= HIGH_FREQUENCY;
+}
+
+void Seed_partition_cache::build(unsigned sid)
+{
+	const size_t n = ref_seqs::data_->raw_len();
+	vector<uint16_t> &v = data_[sid];
+	v.clear();
+	v.resize(n + Sequence_set::PERIMETER_PADDING, HIGH_FREQUENCY);
+	Util::Parallel::scheduled_thread_pool_auto(config.threads_, (n + block_size - 1) / block_size, build_worker, sid, v.data());
+}
+
+void Seed_partition_cache::update_frequent(unsigned sid, const SeedPartitionRange &range)
+{
+	if (config.simple_freq)
+		return;
+	const size_t n = ref_seqs::data_->raw_len();
+	Util::Parallel::scheduled_thread_pool_auto(config.threads_, (n + block_size - 1) / block_size, update_worker, sid, &range, data_[sid].data());
+}
+
+void Seed_partition_cache::clear()
+{
+	for (vector<uint16_t> &v : data_)
+		vector<uint16_t>().swap(v);
+}
@@ -0,0 +1,76 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+                        Eberhard Karls Universitaet Tuebingen
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#ifndef SEED_PARTITION_CACHE_H_
+#define SEED_PARTITION_CACHE_H_
+
+#include <vector>
+#include <stdint.h>
+#include "../basic/const.h"
+#include "../basic/seed.h"
+#include "../basic/value.h"
+#include "seed_histogram.h"
+#include "reference.h"
+
+/* Per position table of the reference block used by the collision filter (--collision-cache). For every shape and
+reference position, an entry holds the seed partition of the seed starting there and a bit that is set if the seed
+is frequent, of low complexity or not a valid seed. The partitions are computed once per shape and reference block,
+the frequency bits are completed after the frequent seed tables of a partition range have been built. */
+struct Seed_partition_cache
+{
+
+	enum { HIGH_FREQUENCY = 1 << 15 };
+
+	void build(unsigned sid);
+	void update_frequent(unsigned sid, const SeedPartitionRange &range);
+	void clear();
+
+	bool enabled(unsigned sid) const
+	{
+		return !data_[sid].empty();
+	}
+
+	uint16_t get(const Letter *pos, unsigned sid) const
+	{
+		return data_[sid][ref_seqs::data_->position(pos)];
+	}
+
+	static unsigned partition(uint16_t entry)
+	{
+		return entry & (Const::seedp - 1);
+	}
+
+	static bool high_frequency(uint16_t entry)
+	{
+		return (entry & HIGH_FREQUENCY) != 0;
+	}
+
+private:
+
+	static void build_worker(size_t i, size_t thread_id, unsigned sid, uint16_t *out);
+	static void update_worker(size_t i, size_t thread_id, unsigned sid, const SeedPartitionRange *range, uint16_t *out);
+
+	std::vector<uint16_t> data_[Const::max_shapes];
+
+};
+
+extern Seed_partition_cache seed_partition_cache;
+
+#endif
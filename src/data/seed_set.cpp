@@ -79,4 +79,33 @@ Hashed_seed_set::Hashed_seed_set(const Sequence_set &seqs)
 	seqs.enum_seeds(v, seqs.partition(1), 0, shapes.count(), &no_filter);
 	for (size_t i = 0; i < shapes.count(); ++i)
 		log_stream << "Shape=" << i << " Hash_table_size=" << data_[i].size() << " load=" << data_[i].load() << endl;
-}
\ No newline at end of file
+}
+struct Bloom_seed_set_callback
+{
+	Bloom_seed_set_callback(BlockedBloomFilter &dst, size_t max_coverage):
+		coverage(0),
+		max_coverage(max_coverage),
+		dst(dst)
+	{}
+	bool operator()(uint64_t seed, uint64_t pos, uint64_t shape)
+	{
+		if (dst.insert(Bloom_seed_set::hash(seed, shape)) && ++coverage > max_coverage)
+			return false;
+		return true;
+	}
+	void finish()
+	{}
+	size_t coverage, max_coverage;
+	BlockedBloomFilter &dst;
+};
+
+Bloom_seed_set::Bloom_seed_set(const Sequence_set &seqs, double fpr, double max_coverage):
+	data_(seqs.letters() * shapes.count(), fpr)
+{
+	const double seed_space = pow(Reduction::reduction.size(), shapes[0].weight_) * shapes.count();
+	PtrVector<Bloom_seed_set_callback> v;
+	v.push_back(new Bloom_seed_set_callback(data_, size_t(std::min(max_coverage * seed_space, (double)SIZE_MAX))));
+	seqs.enum_seeds(v, seqs.partition(1), 0, shapes.count(), &no_filter);
+	coverage_ = (double)v.back().coverage / seed_space;
+	log_stream << "Bloom filter size = " << data_.size_bytes() << " hash functions = " << data_.hash_functions() << endl;
+}
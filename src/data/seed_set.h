@@ -23,6 +23,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "sequence_set.h"
 #include "../util/hash_table.h"
 #include "../util/ptr_vector.h"
+#include "../util/hash_function.h"
+#include "../util/data_structures/bloom_filter.h"
 
 struct Seed_set
 {
@@ -51,4 +53,27 @@ private:
 	PtrVector<PHash_set<Modulo2, No_hash> > data_;
 };
 
+// Approximate seed set of all shapes in a blocked Bloom filter. Reference seeds not in the query are let through at
+// the configured false positive rate, which costs seed array space but does not change the join results.
+struct Bloom_seed_set
+{
+	// Enumeration of contiguous seeds stops once the seed space coverage (averaged over the shapes) exceeds max_coverage.
+	Bloom_seed_set(const Sequence_set &seqs, double fpr, double max_coverage);
+	bool contains(uint64_t key, uint64_t shape) const
+	{
+		return data_.contains(hash(key, shape));
+	}
+	static uint64_t hash(uint64_t key, uint64_t shape)
+	{
+		return murmur_hash()(key ^ (shape * 0x9E3779B97F4A7C15llu));
+	}
+	double coverage() const
+	{
+		return coverage_;
+	}
+private:
+	BlockedBloomFilter data_;
+	double coverage_;
+};
+
 #endif
\ No newline at end of file
@@ -24,11 +24,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <algorithm>
 #include <queue>
 #include <thread>
+#include <limits>
 #include "../basic/sequence.h"
 #include "string_set.h"
 #include "../basic/shape_config.h"
 #include "../basic/seed_iterator.h"
 #include "../util/ptr_vector.h"
+#include "../util/hash_function.h"
+#include "../util/parallel/thread_pool.h"
 
 using std::cout;
 using std::endl;
@@ -136,14 +139,13 @@ struct Sequence_set : public String_set<sequence::DELIMITER, 1>
 		return this->letters() / this->get_length();
 	}
 
+	// If minimizer_window > 1, only the window minimizers of each sequence are enumerated (see enum_seeds_minimizer).
 	template <typename _f, typename _filter>
-	void enum_seeds(PtrVector<_f> &f, const vector<size_t> &p, size_t shape_begin, size_t shape_end, const _filter *filter) const
+	void enum_seeds(PtrVector<_f> &f, const vector<size_t> &p, size_t shape_begin, size_t shape_end, const _filter *filter, size_t minimizer_window = 1) const
 	{
-		std::vector<std::thread> threads;
-		for (unsigned i = 0; i < f.size(); ++i)
-			threads.emplace_back(enum_seeds_worker<_f, _filter>, &f[i], this, (unsigned)p[i], (unsigned)p[i + 1], std::make_pair(shape_begin, shape_end), filter);
-		for (auto &t : threads)
-			t.join();
+		Util::Parallel::ThreadPool::get().run(f.size(), f.size(), [&](size_t i, size_t thread_id) {
+			enum_seeds_worker<_f, _filter>(&f[i], this, (unsigned)p[i], (unsigned)p[i + 1], std::make_pair(shape_begin, shape_end), filter, minimizer_window);
+		});
 	}
 
 	virtual ~Sequence_set()
@@ -175,6 +177,57 @@ private:
 		f->finish();
 	}
 
+	// Samples the seeds of each sequence and shape by (w,1)-minimizers: of every window of w consecutive seed positions,
+	// the seed with the smallest hash value is kept (the leftmost one on ties). Any window of w positions thus keeps at
+	// least one seed, and the density is about 2/(w+1).
+	template<typename _f, typename _filter>
+	void enum_seeds_minimizer(_f *f, unsigned begin, unsigned end, pair<size_t, size_t> shape_range, const _filter *filter, size_t w) const
+	{
+		static const uint64_t INVALID = std::numeric_limits<uint64_t>::max();
+		vector<char> buf(max_len(begin, end));
+		vector<uint64_t> keys, hashes;
+		uint64_t key;
+		for (unsigned i = begin; i < end; ++i) {
+			const sequence seq = (*this)[i];
+			Reduction::reduce_seq(seq, buf);
+			for (size_t shape_id = shape_range.first; shape_id < shape_range.second; ++shape_id) {
+				const Shape& sh = shapes[shape_id];
+				if (seq.length() < sh.length_) continue;
+				keys.clear();
+				hashes.clear();
+				Seed_iterator it(buf, sh);
+				while (it.good()) {
+					const bool valid = it.get(key, sh);
+					keys.push_back(key);
+					hashes.push_back(valid ? murmur_hash()(key) : INVALID);
+				}
+
+				const size_t n = keys.size(), windows = n > w ? n - w + 1 : 1;
+				size_t m = 0, last = n;
+				for (size_t j = 1; j < std::min(w, n); ++j)
+					if (hashes[j] < hashes[m])
+						m = j;
+				for (size_t j = 0; j < windows; ++j) {
+					if (j > 0) {
+						const size_t k = j + w - 1;
+						if (m < j) {
+							m = j;
+							for (size_t l = j + 1; l <= k; ++l)
+								if (hashes[l] < hashes[m])
+									m = l;
+						}
+						else if (hashes[k] < hashes[m])
+							m = k;
+					}
+					if (m != last && hashes[m] != INVALID && filter->contains(keys[m], shape_id))
+						(*f)(keys[m], position(i, m), shape_id);
+					last = m;
+				}
+			}
+		}
+		f->finish();
+	}
+
 	template<typename _f, uint64_t _b, typename _filter>
 	void enum_seeds_hashed(_f *f, unsigned begin, unsigned end, pair<size_t, size_t> shape_range, const _filter *filter) const
 	{
@@ -219,10 +272,15 @@ private:
 	}
 
 	template<typename _f, typename _filter>
-	static void enum_seeds_worker(_f *f, const Sequence_set *seqs, unsigned begin, unsigned end, pair<size_t,size_t> shape_range, const _filter *filter)
+	static void enum_seeds_worker(_f *f, const Sequence_set *seqs, unsigned begin, unsigned end, pair<size_t,size_t> shape_range, const _filter *filter, size_t minimizer_window)
 	{
 		static const char *errmsg = "Unsupported contiguous seed.";
-		if (shape_range.second - shape_range.first == 1 && shapes[shape_range.first].contiguous()) {
+		if (minimizer_window > 1) {
+			if (config.hashed_seeds || (shape_range.second - shape_range.first == 1 && shapes[shape_range.first].contiguous()))
+				throw std::runtime_error("Minimizer sampling is not supported for hashed or contiguous seeds.");
+			seqs->enum_seeds_minimizer<_f, _filter>(f, begin, end, shape_range, filter, minimizer_window);
+		}
+		else if (shape_range.second - shape_range.first == 1 && shapes[shape_range.first].contiguous()) {
 			const uint64_t b = Reduction::reduction.bit_size(), l = shapes[shape_range.first].length_;
 			switch (l) {
 			case 7:
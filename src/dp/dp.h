@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <limits>
 #include <vector>
 #include "../basic/match.h"
+#include "../basic/config.h"
 #include "score_profile.h"
 #include "../basic/translated_position.h"
 #include "../util/simd.h"
@@ -422,11 +423,12 @@ struct Diag_scores {
 
 struct DpTarget
 {
-	DpTarget(const sequence &seq, int d_begin, int d_end, int target_idx = 0) :
+	DpTarget(const sequence &seq, int d_begin, int d_end, int target_idx = 0, int score_hint = 0) :
 		seq(seq),
 		d_begin(d_begin),
 		d_end(d_end),
-		target_idx(target_idx)
+		target_idx(target_idx),
+		score_hint(score_hint)
 	{}
 	int left_i1() const
 	{
@@ -438,23 +440,64 @@ struct DpTarget
 	}
 	sequence seq;
 	int d_begin, d_end, target_idx;
+	// Expected alignment score in the band from an earlier stage (greedy or score only alignment), 0 if unknown. Used
+	// to choose the score width of the kernel.
+	int score_hint;
 };
 
 struct DpStat
 {
 	DpStat():
 		gross_cells(0),
-		net_cells(0)
+		net_cells(0),
+		inter_targets(0),
+		intra_targets(0),
+		wide_targets(0),
+		overflow_targets(0),
+		overflow_cells(0),
+		checkpointed_targets(0),
+		batches(0),
+		partial_batches(0),
+		batch_occupancy(0.0)
 	{}
 	DpStat& operator+=(DpStat &x)
 	{
 		mtx_.lock();
 		gross_cells += x.gross_cells;
 		net_cells += x.net_cells;
+		inter_targets += x.inter_targets;
+		intra_targets += x.intra_targets;
+		wide_targets += x.wide_targets;
+		overflow_targets += x.overflow_targets;
+		overflow_cells += x.overflow_cells;
+		checkpointed_targets += x.checkpointed_targets;
+		batches += x.batches;
+		partial_batches += x.partial_batches;
+		batch_occupancy += x.batch_occupancy;
 		mtx_.unlock();
 		return *this;
 	}
+	void add_batch(size_t gross, size_t net, bool partial)
+	{
+		gross_cells += gross;
+		net_cells += net;
+		++batches;
+		if (partial)
+			++partial_batches;
+		if (gross > 0)
+			batch_occupancy += (double)net / gross;
+	}
+	// Cells computed by the kernels (lanes times rows) and the part of them that belongs to a target, i.e. the lane occupancy.
 	size_t gross_cells, net_cells;
+	// Targets aligned by the inter-sequence (one target per lane) and intra-sequence (one target per vector) banded kernels.
+	size_t inter_targets, intra_targets;
+	// Targets sent to the 32 bit kernel by their score hint, and targets (and their cells) that saturated the 16 bit kernel and were recomputed.
+	size_t wide_targets, overflow_targets, overflow_cells;
+	// Targets aligned with the checkpointed traceback because their traceback matrix exceeded the memory limit.
+	size_t checkpointed_targets;
+	// Batches of the inter-sequence kernels, the ones with fewer targets than lanes, and the sum of their lane occupancies.
+	size_t batches, partial_batches;
+	double batch_occupancy;
 private:
 	std::mutex mtx_;
 };
@@ -480,7 +523,14 @@ DECL_DISPATCH(std::list<Hsp>, swipe, (const sequence &query, const sequence *sub
 
 namespace BandedSwipe {
 
-DECL_DISPATCH(std::list<Hsp>, swipe, (const sequence &query, std::vector<DpTarget>::iterator target_begin, std::vector<DpTarget>::iterator target_end, Frame frame, const Bias_correction *composition_bias, int flags, int score_cutoff))
+// Memory per thread for the traceback matrix of a banded swipe batch. Larger batches are aligned target by target, with
+// a checkpointed traceback for targets that exceed it on their own.
+inline size_t traceback_memory_limit()
+{
+	return size_t(config.traceback_memory * 1e9);
+}
+
+DECL_DISPATCH(std::list<Hsp>, swipe, (const sequence &query, std::vector<DpTarget>::iterator target_begin, std::vector<DpTarget>::iterator target_end, Frame frame, const Bias_correction *composition_bias, DpStat &stat, int flags, int score_cutoff))
 
 }
 
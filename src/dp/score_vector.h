@@ -23,6 +23,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/simd.h"
 #include "../basic/score_matrix.h"
 
+BEGIN_DISPATCH_TYPES
+
 template<typename _score>
 struct score_traits
 {
@@ -280,7 +282,7 @@ struct ScoreTraits<score_vector<uint8_t>>
 template<typename _t, typename _p>
 inline void store_sv(const score_vector<_t> &sv, _p *dst)
 {
-	_mm_storeu_si128((__m128i*)dst, sv.data_);
+	sv.store(dst);
 }
 
 #endif
@@ -305,4 +307,6 @@ inline void set_channel<int>(int &v, int i, int x) {
 	v = x;
 }
 
+END_DISPATCH_TYPES
+
 #endif /* SCORE_VECTOR_H_ */
@@ -21,7 +21,185 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef SCORE_VECTOR_INT16_H_
 #define SCORE_VECTOR_INT16_H_
 
-#ifdef __SSE2__
+BEGIN_DISPATCH_TYPES
+
+#if defined(__AVX512BW__)
+
+template<>
+struct score_vector<int16_t>
+{
+
+	score_vector() :
+		data_(_mm512_set1_epi16(SHRT_MIN))
+	{}
+
+	explicit score_vector(int x)
+	{
+		data_ = _mm512_set1_epi16(x);
+	}
+
+	explicit score_vector(int16_t x)
+	{
+		data_ = _mm512_set1_epi16(x);
+	}
+
+	explicit score_vector(__m512i data) :
+		data_(data)
+	{ }
+
+	score_vector(unsigned a, const __m512i &seq, const score_vector &bias)
+	{
+		const __m128i *row = reinterpret_cast<const __m128i*>(&score_matrix.matrix8u()[a << 5]);
+
+		__m512i high_mask = _mm512_slli_epi16(_mm512_and_si512(seq, _mm512_set1_epi8('\x10')), 3);
+		__m512i seq_low = _mm512_or_si512(seq, high_mask);
+		__m512i seq_high = _mm512_or_si512(seq, _mm512_xor_si512(high_mask, _mm512_set1_epi8('\x80')));
+
+		__m512i r1 = _mm512_broadcast_i32x4(_mm_load_si128(row));
+		__m512i r2 = _mm512_broadcast_i32x4(_mm_load_si128(row + 1));
+		__m512i s1 = _mm512_shuffle_epi8(r1, seq_low);
+		__m512i s2 = _mm512_shuffle_epi8(r2, seq_high);
+		data_ = _mm512_subs_epi16(_mm512_and_si512(_mm512_or_si512(s1, s2), _mm512_set1_epi16(255)), bias.data_);
+	}
+
+	score_vector operator+(const score_vector &rhs) const
+	{
+		return score_vector(_mm512_adds_epi16(data_, rhs.data_));
+	}
+
+	score_vector operator-(const score_vector &rhs) const
+	{
+		return score_vector(_mm512_subs_epi16(data_, rhs.data_));
+	}
+
+	score_vector& operator-=(const score_vector &rhs)
+	{
+		data_ = _mm512_subs_epi16(data_, rhs.data_);
+		return *this;
+	}
+
+	score_vector& max(const score_vector &rhs)
+	{
+		data_ = _mm512_max_epi16(data_, rhs.data_);
+		return *this;
+	}
+
+	friend score_vector max(const score_vector& lhs, const score_vector &rhs)
+	{
+		return score_vector(_mm512_max_epi16(lhs.data_, rhs.data_));
+	}
+
+	void store(int16_t *ptr) const
+	{
+		_mm512_storeu_si512(ptr, data_);
+	}
+
+	int16_t operator[](int i) const {
+		int16_t d[32];
+		store(d);
+		return d[i];
+	}
+
+	void set(int i, int16_t x) {
+		int16_t d[32];
+		store(d);
+		d[i] = x;
+		data_ = _mm512_loadu_si512(d);
+	}
+
+	__m512i data_;
+
+};
+
+#elif defined(__AVX2__)
+
+template<>
+struct score_vector<int16_t>
+{
+
+	score_vector() :
+		data_(_mm256_set1_epi16(SHRT_MIN))
+	{}
+
+	explicit score_vector(int x)
+	{
+		data_ = _mm256_set1_epi16(x);
+	}
+
+	explicit score_vector(int16_t x)
+	{
+		data_ = _mm256_set1_epi16(x);
+	}
+
+	explicit score_vector(__m256i data) :
+		data_(data)
+	{ }
+
+	score_vector(unsigned a, const __m256i &seq, const score_vector &bias)
+	{
+		const __m128i *row = reinterpret_cast<const __m128i*>(&score_matrix.matrix8u()[a << 5]);
+
+		__m256i high_mask = _mm256_slli_epi16(_mm256_and_si256(seq, _mm256_set1_epi8('\x10')), 3);
+		__m256i seq_low = _mm256_or_si256(seq, high_mask);
+		__m256i seq_high = _mm256_or_si256(seq, _mm256_xor_si256(high_mask, _mm256_set1_epi8('\x80')));
+
+		__m256i r1 = _mm256_broadcastsi128_si256(_mm_load_si128(row));
+		__m256i r2 = _mm256_broadcastsi128_si256(_mm_load_si128(row + 1));
+		__m256i s1 = _mm256_shuffle_epi8(r1, seq_low);
+		__m256i s2 = _mm256_shuffle_epi8(r2, seq_high);
+		data_ = _mm256_subs_epi16(_mm256_and_si256(_mm256_or_si256(s1, s2), _mm256_set1_epi16(255)), bias.data_);
+	}
+
+	score_vector operator+(const score_vector &rhs) const
+	{
+		return score_vector(_mm256_adds_epi16(data_, rhs.data_));
+	}
+
+	score_vector operator-(const score_vector &rhs) const
+	{
+		return score_vector(_mm256_subs_epi16(data_, rhs.data_));
+	}
+
+	score_vector& operator-=(const score_vector &rhs)
+	{
+		data_ = _mm256_subs_epi16(data_, rhs.data_);
+		return *this;
+	}
+
+	score_vector& max(const score_vector &rhs)
+	{
+		data_ = _mm256_max_epi16(data_, rhs.data_);
+		return *this;
+	}
+
+	friend score_vector max(const score_vector& lhs, const score_vector &rhs)
+	{
+		return score_vector(_mm256_max_epi16(lhs.data_, rhs.data_));
+	}
+
+	void store(int16_t *ptr) const
+	{
+		_mm256_storeu_si256((__m256i*)ptr, data_);
+	}
+
+	int16_t operator[](int i) const {
+		int16_t d[16];
+		store(d);
+		return d[i];
+	}
+
+	void set(int i, int16_t x) {
+		int16_t d[16];
+		store(d);
+		d[i] = x;
+		data_ = _mm256_loadu_si256((__m256i*)d);
+	}
+
+	__m256i data_;
+
+};
+
+#elif defined(__SSE2__)
 
 template<>
 struct score_vector<int16_t>
@@ -142,10 +320,14 @@ struct score_vector<int16_t>
 
 };
 
+#endif
+
+#ifdef __SSE2__
+
 template<>
 struct ScoreTraits<score_vector<int16_t>>
 {
-	enum { CHANNELS = 8 };
+	enum { CHANNELS = sizeof(score_vector<int16_t>) / sizeof(int16_t) };
 	typedef int16_t Score;
 	static score_vector<int16_t> zero()
 	{
@@ -170,4 +352,6 @@ struct ScoreTraits<score_vector<int16_t>>
 
 #endif
 
+END_DISPATCH_TYPES
+
 #endif
\ No newline at end of file
@@ -21,7 +21,215 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "score_vector.h"
 
-#ifdef __SSE4_1__
+BEGIN_DISPATCH_TYPES
+
+#if defined(__AVX512BW__)
+
+template<>
+struct score_vector<int8_t>
+{
+
+	score_vector():
+		data_(_mm512_set1_epi8(std::numeric_limits<char>::min()))
+	{}
+
+	score_vector(__m512i data):
+		data_(data)
+	{}
+
+	score_vector(int8_t x):
+		data_(_mm512_set1_epi8(x))
+	{}
+
+	score_vector(const int8_t* s) :
+		data_(_mm512_loadu_si512(s))
+	{ }
+
+	score_vector(unsigned a, const __m512i &seq)
+	{
+		const __m128i *row = reinterpret_cast<const __m128i*>(&score_matrix.matrix8()[a << 5]);
+
+		__m512i high_mask = _mm512_slli_epi16(_mm512_and_si512(seq, _mm512_set1_epi8('\x10')), 3);
+		__m512i seq_low = _mm512_or_si512(seq, high_mask);
+		__m512i seq_high = _mm512_or_si512(seq, _mm512_xor_si512(high_mask, _mm512_set1_epi8('\x80')));
+
+		__m512i r1 = _mm512_broadcast_i32x4(_mm_load_si128(row));
+		__m512i r2 = _mm512_broadcast_i32x4(_mm_load_si128(row + 1));
+		__m512i s1 = _mm512_shuffle_epi8(r1, seq_low);
+		__m512i s2 = _mm512_shuffle_epi8(r2, seq_high);
+		data_ = _mm512_or_si512(s1, s2);
+	}
+
+	score_vector operator+(const score_vector &rhs) const
+	{
+		return score_vector(_mm512_adds_epi8(data_, rhs.data_));
+	}
+
+	score_vector operator-(const score_vector &rhs) const
+	{
+		return score_vector(_mm512_subs_epi8(data_, rhs.data_));
+	}
+
+	score_vector& operator-=(const score_vector &rhs)
+	{
+		data_ = _mm512_subs_epi8(data_, rhs.data_);
+		return *this;
+	}
+
+	int operator [](unsigned i) const
+	{
+		return *(((uint8_t*)&data_) + i);
+	}
+
+	void set(unsigned i, uint8_t v)
+	{
+		*(((uint8_t*)&data_) + i) = v;
+	}
+
+	score_vector& max(const score_vector &rhs)
+	{
+		data_ = _mm512_max_epi8(data_, rhs.data_);
+		return *this;
+	}
+
+	score_vector& min(const score_vector &rhs)
+	{
+		data_ = _mm512_min_epi8(data_, rhs.data_);
+		return *this;
+	}
+
+	friend score_vector max(const score_vector& lhs, const score_vector &rhs)
+	{
+		return score_vector(_mm512_max_epi8(lhs.data_, rhs.data_));
+	}
+
+	friend score_vector min(const score_vector& lhs, const score_vector &rhs)
+	{
+		return score_vector(_mm512_min_epi8(lhs.data_, rhs.data_));
+	}
+
+	void store(int8_t *ptr) const
+	{
+		_mm512_storeu_si512(ptr, data_);
+	}
+
+	friend std::ostream& operator<<(std::ostream &s, score_vector v)
+	{
+		int8_t x[64];
+		v.store(x);
+		for (unsigned i = 0; i < 64; ++i)
+			printf("%3i ", (int)x[i]);
+		return s;
+	}
+
+	__m512i data_;
+
+};
+
+#elif defined(__AVX2__)
+
+template<>
+struct score_vector<int8_t>
+{
+
+	score_vector():
+		data_(_mm256_set1_epi8(std::numeric_limits<char>::min()))
+	{}
+
+	score_vector(__m256i data):
+		data_(data)
+	{}
+
+	score_vector(int8_t x):
+		data_(_mm256_set1_epi8(x))
+	{}
+
+	score_vector(const int8_t* s) :
+		data_(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(s)))
+	{ }
+
+	score_vector(unsigned a, const __m256i &seq)
+	{
+		const __m128i *row = reinterpret_cast<const __m128i*>(&score_matrix.matrix8()[a << 5]);
+
+		__m256i high_mask = _mm256_slli_epi16(_mm256_and_si256(seq, _mm256_set1_epi8('\x10')), 3);
+		__m256i seq_low = _mm256_or_si256(seq, high_mask);
+		__m256i seq_high = _mm256_or_si256(seq, _mm256_xor_si256(high_mask, _mm256_set1_epi8('\x80')));
+
+		__m256i r1 = _mm256_broadcastsi128_si256(_mm_load_si128(row));
+		__m256i r2 = _mm256_broadcastsi128_si256(_mm_load_si128(row + 1));
+		__m256i s1 = _mm256_shuffle_epi8(r1, seq_low);
+		__m256i s2 = _mm256_shuffle_epi8(r2, seq_high);
+		data_ = _mm256_or_si256(s1, s2);
+	}
+
+	score_vector operator+(const score_vector &rhs) const
+	{
+		return score_vector(_mm256_adds_epi8(data_, rhs.data_));
+	}
+
+	score_vector operator-(const score_vector &rhs) const
+	{
+		return score_vector(_mm256_subs_epi8(data_, rhs.data_));
+	}
+
+	score_vector& operator-=(const score_vector &rhs)
+	{
+		data_ = _mm256_subs_epi8(data_, rhs.data_);
+		return *this;
+	}
+
+	int operator [](unsigned i) const
+	{
+		return *(((uint8_t*)&data_) + i);
+	}
+
+	void set(unsigned i, uint8_t v)
+	{
+		*(((uint8_t*)&data_) + i) = v;
+	}
+
+	score_vector& max(const score_vector &rhs)
+	{
+		data_ = _mm256_max_epi8(data_, rhs.data_);
+		return *this;
+	}
+
+	score_vector& min(const score_vector &rhs)
+	{
+		data_ = _mm256_min_epi8(data_, rhs.data_);
+		return *this;
+	}
+
+	friend score_vector max(const score_vector& lhs, const score_vector &rhs)
+	{
+		return score_vector(_mm256_max_epi8(lhs.data_, rhs.data_));
+	}
+
+	friend score_vector min(const score_vector& lhs, const score_vector &rhs)
+	{
+		return score_vector(_mm256_min_epi8(lhs.data_, rhs.data_));
+	}
+
+	void store(int8_t *ptr) const
+	{
+		_mm256_storeu_si256((__m256i*)ptr, data_);
+	}
+
+	friend std::ostream& operator<<(std::ostream &s, score_vector v)
+	{
+		int8_t x[32];
+		v.store(x);
+		for (unsigned i = 0; i < 32; ++i)
+			printf("%3i ", (int)x[i]);
+		return s;
+	}
+
+	__m256i data_;
+
+};
+
+#elif defined(__SSE4_1__)
 
 template<>
 struct score_vector<int8_t>
@@ -155,10 +363,14 @@ struct score_vector<int8_t>
 
 };
 
+#endif
+
+#ifdef __SSE4_1__
+
 template<>
 struct ScoreTraits<score_vector<int8_t>>
 {
-	enum { CHANNELS = 16 };
+	enum { CHANNELS = sizeof(score_vector<int8_t>) / sizeof(int8_t) };
 	typedef int8_t Score;
 	static score_vector<int8_t> zero() {
 		return score_vector<int8_t>();
@@ -178,4 +390,6 @@ struct ScoreTraits<score_vector<int8_t>>
 
 #endif
 
+END_DISPATCH_TYPES
+
 #endif
\ No newline at end of file
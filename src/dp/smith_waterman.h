@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stddef.h>
 #include "score_profile.h"
 #include "dp_matrix.h"
+#include "../util/simd/transpose.h"
 
 namespace Search { namespace DISPATCH_ARCH {
 
@@ -121,6 +122,82 @@ void smith_waterman(const sequence &query,
 	#endif
 }
 
+// Computes the substitution scores of the band for smith_waterman_lanes: lane k < n aligns query[k][0, len) to
+// subject[k][0, len), the scores of the remaining lanes are zero. With SSSE3, the band of each lane and column is
+// looked up by one shuffle from the matrix column of the subject letter and the lanes are transposed in blocks of 16.
+// Query letters up to 16 positions outside the window on either side are read but not used.
+inline void window_lane_scores(const Letter * const *query, const Letter * const *subject, unsigned n, unsigned len, unsigned band, vector<score_vector<uint8_t>> &out)
+{
+	enum { CHANNELS = score_traits<uint8_t>::channels };
+	const unsigned band_width = 2 * band + 1;
+	const uint8_t *matrix = score_matrix.matrix8u();
+	out.resize(len * band_width);
+#ifdef __SSSE3__
+	alignas(16) uint8_t matrix_t[32 * 32];
+	alignas(16) char lanes[CHANNELS * 16], rows[CHANNELS * 16];
+	for (unsigned i = 0; i < 32; ++i)
+		for (unsigned j = 0; j < 32; ++j)
+			matrix_t[(j << 5) | i] = matrix[(i << 5) | j];
+	std::fill(lanes, lanes + sizeof(lanes), 0);
+	const __m128i m16 = _mm_set1_epi8('\x10'), m80 = _mm_set1_epi8('\x80');
+	for (unsigned j = 0; j < len; ++j)
+		for (unsigned d0 = 0; d0 < band_width; d0 += 16) {
+			for (unsigned k = 0; k < n; ++k) {
+				const __m128i *row = reinterpret_cast<const __m128i*>(&matrix_t[(unsigned)subject[k][j] << 5]);
+				const __m128i seq = _mm_loadu_si128(reinterpret_cast<const __m128i*>(query[k] + j + d0 - band));
+				const __m128i high_mask = _mm_slli_epi16(_mm_and_si128(seq, m16), 3);
+				const __m128i s1 = _mm_shuffle_epi8(_mm_load_si128(row), _mm_or_si128(seq, high_mask));
+				const __m128i s2 = _mm_shuffle_epi8(_mm_load_si128(row + 1), _mm_or_si128(seq, _mm_xor_si128(high_mask, m80)));
+				_mm_store_si128(reinterpret_cast<__m128i*>(lanes + k * 16), _mm_or_si128(s1, s2));
+			}
+			transpose(lanes, rows, 0);
+			for (unsigned d = d0; d < std::min(d0 + 16, band_width); ++d)
+				out[j * band_width + d] = score_vector<uint8_t>(_mm_load_si128(reinterpret_cast<const __m128i*>(rows + (d - d0) * 16)));
+		}
+#else
+	uint8_t *scores = (uint8_t*)out.data();
+	std::fill(scores, scores + out.size() * CHANNELS, 0);
+	for (unsigned k = 0; k < n; ++k)
+		for (unsigned j = 0; j < len; ++j) {
+			const unsigned r_begin = j >= band ? j - band : 0, r_end = std::min(j + band + 1, len), s = (unsigned)subject[k][j];
+			uint8_t *dst = scores + (j * band_width + band - j) * CHANNELS + k;
+			for (unsigned r = r_begin; r < r_end; ++r)
+				dst[r * CHANNELS] = matrix[((unsigned)query[k][r] << 5) | s];
+		}
+#endif
+}
+
+// Banded local alignment of up to score_traits<_score>::channels window pairs at once, one pair per lane. All pairs
+// have the same length len and the band is centered on the main diagonal. The substitution scores are supplied per
+// lane in scores[j * (2 * band + 1) + d] for subject position j and query position j + d - band. Returns the best
+// score of each lane.
+template<typename _score>
+score_vector<_score> smith_waterman_lanes(unsigned len, unsigned band, const score_vector<_score> *scores, int op, int ep)
+{
+	typedef score_vector<_score> sv;
+
+	DP_matrix<_score> dp(len, len, band, 0);
+	const sv open_penalty(static_cast<char>(op)), extend_penalty(static_cast<char>(ep)), vbias(score_matrix.bias());
+	const unsigned band_width = 2 * band + 1;
+	sv best;
+	dp.clear();
+
+	for (unsigned j = 0; j < len; ++j) {
+		typename DP_matrix<_score>::Column_iterator it(dp.begin(j));
+		const sv *column_scores = scores + j * band_width + band - j;
+		sv vgap, hgap, column_best;
+		while (!it.at_end()) {
+			hgap = it.hgap();
+			sv next = cell_update<_score>(it.diag(), column_scores[it.row_pos_], extend_penalty, open_penalty, hgap, vgap, column_best, vbias);
+			it.set_hgap(hgap);
+			it.set_score(next);
+			++it;
+		}
+		best.max(column_best);
+	}
+	return best;
+}
+
 #endif
 
 }}
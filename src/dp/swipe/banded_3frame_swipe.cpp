@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "target_iterator.h"
 #include "../../util/data_structures/mem_buffer.h"
 #include "../score_vector_int16.h"
+#include "../../util/parallel/thread_pool.h"
 
 using std::list;
 using std::thread;
@@ -427,6 +428,7 @@ list<Hsp> banded_3frame_swipe(
 		best[i] = ScoreTraits<_sv>::zero_score();
 		max_col[i] = 0;
 	}
+	size_t gross_cells = 0, net_cells = 0;
 
 	int j = 0;
 	while (targets.active.size() > 0) {
@@ -464,10 +466,8 @@ list<Hsp> banded_3frame_swipe(
 			++it;
 		}
 
-#ifdef DP_STAT
-		stat.net_cells += targets.live * (i1_ - i0_ + 1) * 3;
-		stat.gross_cells += ScoreTraits<_sv>::CHANNELS * (i1_ - i0_ + 1) * 3;
-#endif
+		net_cells += targets.live * (i1_ - i0_ + 1) * 3;
+		gross_cells += ScoreTraits<_sv>::CHANNELS * (i1_ - i0_ + 1) * 3;
 
 		Score col_best_[ScoreTraits<_sv>::CHANNELS];
 		store_sv(col_best, col_best_);
@@ -486,6 +486,7 @@ list<Hsp> banded_3frame_swipe(
 		++i1;
 		++j;
 	}
+	stat.add_batch(gross_cells, net_cells, targets.n_targets < ScoreTraits<_sv>::CHANNELS);
 	
 	list<Hsp> out;
 	for (int i = 0; i < targets.n_targets; ++i) {
@@ -517,25 +518,24 @@ list<Hsp> banded_3frame_swipe_targets(vector<DpTarget>::const_iterator begin,
 	return out;
 }
 
-void banded_3frame_swipe_worker(vector<DpTarget>::const_iterator begin,
+void banded_3frame_swipe_worker(size_t i,
+	size_t thread_id,
+	vector<DpTarget>::const_iterator begin,
 	vector<DpTarget>::const_iterator end,
-	atomic<size_t> *next,
 	bool score_only,
 	const TranslatedSequence *query,
 	Strand strand,
-	list<Hsp> *out,
-	vector<DpTarget> *overflow)
+	vector<list<Hsp>> *out,
+	vector<vector<DpTarget>> *overflow,
+	vector<DpStat> *stat)
 {
-	DpStat stat;
-	size_t pos;
-	vector<DpTarget> of;
-	while (begin + (pos = next->fetch_add(config.swipe_chunk_size)) < end)
+	const size_t pos = i * config.swipe_chunk_size;
+	list<Hsp> &o = (*out)[thread_id];
 #ifdef __SSE2__
-		out->splice(out->end(), banded_3frame_swipe_targets<score_vector<int16_t>>(begin + pos, min(begin + pos + config.swipe_chunk_size, end), score_only, *query, strand, stat, true, of));
+	o.splice(o.end(), banded_3frame_swipe_targets<score_vector<int16_t>>(begin + pos, min(begin + pos + config.swipe_chunk_size, end), score_only, *query, strand, (*stat)[thread_id], true, (*overflow)[thread_id]));
 #else
-		out->splice(out->end(), banded_3frame_swipe_targets<int32_t>(begin + pos, min(begin + pos + config.swipe_chunk_size, end), score_only, *query, strand, stat, true, of));
+	o.splice(o.end(), banded_3frame_swipe_targets<int32_t>(begin + pos, min(begin + pos + config.swipe_chunk_size, end), score_only, *query, strand, (*stat)[thread_id], true, (*overflow)[thread_id]));
 #endif
-	*overflow = std::move(of);
 }
 
 list<Hsp> banded_3frame_swipe(const TranslatedSequence &query, Strand strand, vector<DpTarget>::iterator target_begin, vector<DpTarget>::iterator target_end, DpStat &stat, bool score_only, bool parallel)
@@ -547,32 +547,28 @@ list<Hsp> banded_3frame_swipe(const TranslatedSequence &query, Strand strand, ve
 	list<Hsp> out;
 	if (parallel) {
 		timer.go("Banded 3frame swipe (run)");
-		vector<thread> threads;
-		vector<list<Hsp>*> thread_out;
+		vector<list<Hsp>> thread_out(config.threads_);
 		vector<vector<DpTarget>> thread_overflow(config.threads_);
-		atomic<size_t> next(0);
-		for (size_t i = 0; i < config.threads_; ++i) {
-			thread_out.push_back(new list<Hsp>);
-			threads.emplace_back(banded_3frame_swipe_worker,
-				target_begin,
-				target_end,
-				&next,
-				score_only,
-				&query,
-				strand,
-				thread_out.back(),
-				&thread_overflow[i]);
-		}
-		for (auto &t : threads)
-			t.join();
+		vector<DpStat> thread_stat(config.threads_);
+		Util::Parallel::scheduled_thread_pool_auto(config.threads_,
+			(target_end - target_begin + config.swipe_chunk_size - 1) / config.swipe_chunk_size,
+			banded_3frame_swipe_worker,
+			target_begin,
+			target_end,
+			score_only,
+			&query,
+			strand,
+			&thread_out,
+			&thread_overflow,
+			&thread_stat);
 		timer.go("Banded 3frame swipe (merge)");
-		for (list<Hsp>* l : thread_out) {
-			out.splice(out.end(), *l);
-			delete l;
-		}
+		for (list<Hsp> &l : thread_out)
+			out.splice(out.end(), l);
 		overflow16.reserve(std::accumulate(thread_overflow.begin(), thread_overflow.end(), (size_t)0, [](size_t n, const vector<DpTarget> &v) { return n + v.size(); }));
 		for (const vector<DpTarget> &v : thread_overflow)
 			overflow16.insert(overflow16.end(), v.begin(), v.end());
+		for (DpStat &s : thread_stat)
+			stat += s;
 	}
 	else
 		out = banded_3frame_swipe_targets<score_vector<int16_t>>(target_begin, target_end, score_only, query, strand, stat, false, overflow16);
@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <algorithm>
 #include <list>
+#include <type_traits>
 #include "../dp.h"
 #include "swipe.h"
 #include "target_iterator.h"
@@ -261,13 +262,13 @@ struct MatrixTag<_sv, ScoreOnly>
 	typedef Matrix<_sv> Type;
 };
 
-template<typename _sv>
-Hsp traceback(const sequence &query, Frame frame, const int8_t *bias_correction, const TracebackMatrix<_sv> &dp, const DpTarget &target, int d_begin, typename ScoreTraits<_sv>::Score max_score, int max_col, int channel, int i0, int i1)
+// Walks the traceback from the cell of it, next_step(it) is called before each step.
+template<typename _sv, typename _f>
+Hsp traceback_walk(const sequence &query, Frame frame, const int8_t *bias_correction, const DpTarget &target, int d_begin, typename ScoreTraits<_sv>::Score max_score, typename TracebackMatrix<_sv>::TracebackIterator &it, _f next_step)
 {
 	typedef typename ScoreTraits<_sv>::Score Score;
-	const int j0 = i1 - (target.d_end - 1), d1 = target.d_end;
-	typename TracebackMatrix<_sv>::TracebackIterator it(dp.traceback(max_col + 1, i0 + max_col, j0 + max_col, (int)query.length(), channel, max_score));
-	
+	const int d1 = target.d_end;
+
 	Hsp out;
 	out.swipe_target = target.target_idx;
 	out.score = ScoreTraits<_sv>::int_score(max_score);
@@ -278,6 +279,7 @@ Hsp traceback(const sequence &query, Frame frame, const int8_t *bias_correction,
 	out.subject_range.end_ = it.j + 1;
 	
 	while (it.score() > ScoreTraits<_sv>::zero_score()) {
+		next_step(it);
 		const Letter q = query[it.i], s = target.seq[it.j];
 		Score m = score_matrix(q, s), score = it.score();
 		if (bias_correction)
@@ -298,6 +300,14 @@ Hsp traceback(const sequence &query, Frame frame, const int8_t *bias_correction,
 	return out;
 }
 
+template<typename _sv>
+Hsp traceback(const sequence &query, Frame frame, const int8_t *bias_correction, const TracebackMatrix<_sv> &dp, const DpTarget &target, int d_begin, typename ScoreTraits<_sv>::Score max_score, int max_col, int channel, int i0, int i1)
+{
+	const int j0 = i1 - (target.d_end - 1);
+	typename TracebackMatrix<_sv>::TracebackIterator it(dp.traceback(max_col + 1, i0 + max_col, j0 + max_col, (int)query.length(), channel, max_score));
+	return traceback_walk<_sv>(query, frame, bias_correction, target, d_begin, max_score, it, [](typename TracebackMatrix<_sv>::TracebackIterator&) {});
+}
+
 template<typename _sv>
 Hsp traceback(const sequence &query, Frame frame, const int8_t *bias_correction, const Matrix<_sv> &dp, const DpTarget &target, int d_begin, typename ScoreTraits<_sv>::Score max_score, int max_col, int channel, int i0, int i1)
 {
@@ -317,7 +327,8 @@ list<Hsp> swipe(
 	vector<DpTarget>::const_iterator subject_end,
 	const int8_t *composition_bias,
 	int score_cutoff,
-	vector<DpTarget> &overflow)
+	vector<DpTarget> &overflow,
+	DpStat &stat)
 {
 	typedef typename ScoreTraits<_sv>::Score Score;
 	typedef typename MatrixTag<_sv, _traceback>::Type Matrix;
@@ -345,9 +356,11 @@ list<Hsp> swipe(
 
 	Score best[ScoreTraits<_sv>::CHANNELS];
 	int max_col[ScoreTraits<_sv>::CHANNELS];
+	size_t cells[ScoreTraits<_sv>::CHANNELS], gross_cells = 0, net_cells = 0;
 	for (int i = 0; i < ScoreTraits<_sv>::CHANNELS; ++i) {
 		best[i] = ScoreTraits<_sv>::zero_score();
 		max_col[i] = 0;
+		cells[i] = 0;
 	}
 
 	int j = 0;
@@ -378,6 +391,8 @@ list<Hsp> swipe(
 		store_sv(col_best, col_best_);
 		for (int i = 0; i < targets.active.size();) {
 			int channel = targets.active[i];
+			if (targets.pos[channel] >= 0)
+				cells[channel] += i1_ - i0_ + 1;
 			if (!targets.inc(channel))
 				targets.active.erase(i);
 			else
@@ -387,28 +402,312 @@ list<Hsp> swipe(
 				max_col[channel] = j;
 			}
 		}
+		gross_cells += ScoreTraits<_sv>::CHANNELS * (i1_ - i0_ + 1);
+		net_cells += targets.live * (i1_ - i0_ + 1);
 		++i0;
 		++i1;
 		++j;
 	}
 
+	stat.add_batch(gross_cells, net_cells, targets.n_targets < ScoreTraits<_sv>::CHANNELS);
+	stat.inter_targets += targets.n_targets;
 	list<Hsp> out;
 	for (int i = 0; i < targets.n_targets; ++i) {
 		if (best[i] < ScoreTraits<_sv>::max_score()) {
 			if (ScoreTraits<_sv>::int_score(best[i]) >= score_cutoff)
 				out.push_back(traceback<_sv>(query, frame, composition_bias, dp, subject_begin[i], d_begin[i], best[i], max_col[i], i, i0 - j, i1 - j));
 		}
-		else
+		else {
 			overflow.push_back(subject_begin[i]);
+			++stat.overflow_targets;
+			stat.overflow_cells += cells[i];
+		}
+	}
+	return out;
+}
+
+#ifdef __SSE4_1__
+
+namespace Intra {
+
+#ifdef __AVX2__
+
+typedef __m256i Vec;
+inline Vec set1(int x) { return _mm256_set1_epi32(x); }
+inline Vec loadu(const int32_t *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline void storeu(int32_t *p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+inline Vec add(Vec a, Vec b) { return _mm256_add_epi32(a, b); }
+inline Vec sub(Vec a, Vec b) { return _mm256_sub_epi32(a, b); }
+inline Vec max(Vec a, Vec b) { return _mm256_max_epi32(a, b); }
+inline Vec mul(Vec a, Vec b) { return _mm256_mullo_epi32(a, b); }
+inline Vec lanes() { return _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0); }
+inline Vec shift4(Vec a) { return _mm256_permute2x128_si256(a, a, 0x08); }
+inline Vec shift1(Vec a) { return _mm256_alignr_epi8(a, shift4(a), 12); }
+inline Vec shift2(Vec a) { return _mm256_alignr_epi8(a, shift4(a), 8); }
+inline Vec prefix_max(Vec a)
+{
+	a = max(a, shift1(a));
+	a = max(a, shift2(a));
+	return max(a, shift4(a));
+}
+inline Vec broadcast_last(Vec a) { return _mm256_permutevar8x32_epi32(a, _mm256_set1_epi32(7)); }
+inline __m128i fold(Vec a) { return _mm_max_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1)); }
+
+#else
+
+typedef __m128i Vec;
+inline Vec set1(int x) { return _mm_set1_epi32(x); }
+inline Vec loadu(const int32_t *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline void storeu(int32_t *p, Vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+inline Vec add(Vec a, Vec b) { return _mm_add_epi32(a, b); }
+inline Vec sub(Vec a, Vec b) { return _mm_sub_epi32(a, b); }
+inline Vec max(Vec a, Vec b) { return _mm_max_epi32(a, b); }
+inline Vec mul(Vec a, Vec b) { return _mm_mullo_epi32(a, b); }
+inline Vec lanes() { return _mm_set_epi32(3, 2, 1, 0); }
+inline Vec shift1(Vec a) { return _mm_slli_si128(a, 4); }
+inline Vec prefix_max(Vec a)
+{
+	a = max(a, shift1(a));
+	return max(a, _mm_slli_si128(a, 8));
+}
+inline Vec broadcast_last(Vec a) { return _mm_shuffle_epi32(a, 0xff); }
+inline __m128i fold(Vec a) { return a; }
+
+#endif
+
+enum { LANES = sizeof(Vec) / sizeof(int32_t) };
+
+inline int32_t first(Vec a)
+{
+	return _mm_cvtsi128_si32(fold(a));
+}
+
+inline int32_t hmax(Vec a)
+{
+	__m128i m = fold(a);
+	m = _mm_max_epi32(m, _mm_shuffle_epi32(m, 0x4e));
+	m = _mm_max_epi32(m, _mm_shuffle_epi32(m, 0xb1));
+	return _mm_cvtsi128_si32(m);
+}
+
+}
+
+#endif
+
+#ifdef __SSE4_1__
+enum { INTRA_LANES = Intra::LANES };
+#else
+enum { INTRA_LANES = 1 };
+#endif
+
+inline int32_t* score_out(Matrix<int32_t>::ColumnIterator &it)
+{
+	return it.score_ptr_;
+}
+
+inline int32_t* score_out(TracebackMatrix<int32_t>::ColumnIterator &it)
+{
+	return it.score_ptr1_;
+}
+
+/* Computes n rows of a column of the intra-sequence layout. diag points to the previous column, h to the column being
+computed (which may be the same memory), hgap to the horizontal gaps (read at +1, written at +0) and scores to the
+profile row of the subject letter. Vertical gaps run along the lanes and are resolved by a prefix maximum of
+H + row * (gap extend) over the scores of the cells without vertical gaps, which gives the same cell scores since a
+vertical gap opened from a cell that ends a vertical gap never beats extending that gap. Returns the best score of the
+column. */
+inline int32_t intra_column(const int32_t *diag, const int32_t *scores, int32_t *h, int32_t *hgap, int n, int32_t open, int32_t extend)
+{
+	int r = 0;
+	int32_t col_best = 0, p = 0;
+#ifdef __SSE4_1__
+	using namespace Intra;
+	const Vec open_v = set1(open), extend_v = set1(extend), zero = set1(0), step = set1(LANES * extend);
+	Vec row = mul(lanes(), extend_v), carry = zero, best = zero;
+	for (; r + LANES <= n; r += LANES) {
+		const Vec e = loadu(hgap + r + 1), h0 = max(max(add(loadu(diag + r), loadu(scores + r)), e), zero),
+			prefix = max(prefix_max(add(h0, row)), carry),
+			cell = max(h0, sub(add(max(shift1(prefix), carry), extend_v), add(row, open_v)));
+		storeu(h + r, cell);
+		storeu(hgap + r, max(sub(e, extend_v), sub(cell, open_v)));
+		best = max(best, cell);
+		carry = broadcast_last(prefix);
+		row = add(row, step);
+	}
+	col_best = hmax(best);
+	p = first(carry);
+#endif
+	for (; r < n; ++r) {
+		const int32_t e = hgap[r + 1], h0 = std::max(std::max(diag[r] + scores[r], e), 0),
+			cell = std::max(h0, p - open - (r - 1) * extend);
+		h[r] = cell;
+		hgap[r] = std::max(e - extend, cell - open);
+		col_best = std::max(col_best, cell);
+		p = std::max(p, h0 + r * extend);
+	}
+	return col_best;
+}
+
+void build_intra_profile(const sequence &query, const int8_t *composition_bias, vector<int32_t> &out)
+{
+	const int qlen = (int)query.length();
+	out.resize(32 * qlen);
+	for (int l = 0; l < 32; ++l) {
+		const int32_t *row = score_matrix.row((char)l);
+		int32_t *p = &out[l * qlen];
+		for (int i = 0; i < qlen; ++i)
+			p[i] = row[(int)query[i]] + (composition_bias ? composition_bias[i] : 0);
+	}
+}
+
+/* Intra-sequence alignment with a traceback in bounded memory, for targets whose traceback matrix would exceed
+traceback_memory_limit(). The forward pass keeps a single column and saves the score and horizontal gap columns every
+interval columns. The traceback then walks through windows of columns that are recomputed from the closest checkpoint
+in the layout of TracebackMatrix. A window reaches at least one band behind the current cell, which is as far as a gap
+can go. */
+list<Hsp> swipe_checkpointed(
+	const sequence &query,
+	Frame frame,
+	const DpTarget &target,
+	int band,
+	const int32_t *profile,
+	const int8_t *composition_bias,
+	int score_cutoff,
+	DpStat &stat)
+{
+	const int qlen = (int)query.length(), slen = (int)target.seq.length(), d_begin = target.d_end - band,
+		i0 = std::max(target.d_end - 1, 0) + 1 - band, j0 = std::max(target.d_end - 1, 0) - (target.d_end - 1),
+		interval = (int)std::min(std::max(((int64_t)(traceback_memory_limit() / sizeof(int32_t) / band) - band - 1) / 2, (int64_t)32), (int64_t)INT_MAX);
+	const int32_t open = score_matrix.gap_open() + score_matrix.gap_extend(), extend = score_matrix.gap_extend();
+	vector<int32_t> h(band, 0), hgap(band + 1, 0), checkpoints, window;
+	int32_t best = 0;
+	int max_col = 0, cols = 0;
+
+	for (int j = j0; j < slen; ++j, ++cols) {
+		const int i0_ = std::max(i0 + cols, 0), i1_ = std::min(i0 + cols + band - 1, qlen - 1);
+		if (i0_ > i1_)
+			break;
+		if (cols % interval == 0) {
+			checkpoints.insert(checkpoints.end(), h.begin(), h.end());
+			checkpoints.insert(checkpoints.end(), hgap.begin(), hgap.end());
+		}
+		const int offset = i0_ - (i0 + cols), n = i1_ - i0_ + 1;
+		const int32_t col_best = intra_column(&h[offset], profile + (int)target.seq[j] * qlen + i0_, &h[offset], &hgap[offset], n, open, extend);
+		stat.gross_cells += (n + INTRA_LANES - 1) / INTRA_LANES * INTRA_LANES;
+		stat.net_cells += n;
+		if (col_best > best) {
+			best = col_best;
+			max_col = cols;
+		}
 	}
+
+	++stat.intra_targets;
+	++stat.checkpointed_targets;
+	list<Hsp> out;
+	if (best < score_cutoff)
+		return out;
+
+	// Recomputes the columns up to end from the last checkpoint that leaves at least band + interval columns, returns the first column.
+	auto recompute = [&](int end) {
+		const int begin = std::max(end - band - interval, 0) / interval * interval;
+		window.resize(size_t(end - begin + 1) * band);
+		const int32_t *checkpoint = &checkpoints[size_t(begin / interval) * (2 * band + 1)];
+		std::copy(checkpoint, checkpoint + band, window.begin());
+		std::copy(checkpoint + band, checkpoint + 2 * band + 1, hgap.begin());
+		for (int col = begin; col < end; ++col) {
+			const int i0_ = std::max(i0 + col, 0), i1_ = std::min(i0 + col + band - 1, qlen - 1), offset = i0_ - (i0 + col);
+			int32_t *column = &window[size_t(col - begin) * band];
+			if (offset > 0)
+				column[band + offset - 1] = 0;
+			intra_column(column + offset, profile + (int)target.seq[j0 + col] * qlen + i0_, column + band + offset, &hgap[offset], i1_ - i0_ + 1, open, extend);
+		}
+		return begin;
+	};
+
+	int begin = recompute(max_col + 1);
+	const int i0_max = i0 + max_col, r1 = std::min(band, qlen - i0_max);
+	const int32_t *column = &window[size_t(max_col - begin + 1) * band];
+	int r = std::max(-i0_max, 0);
+	while (r < r1 && column[r] != best)
+		++r;
+	if (r == r1)
+		throw std::runtime_error("Traceback error.");
+
+	TracebackMatrix<int32_t>::TracebackIterator it(column + r, band, i0_max + r, j0 + max_col);
+	out.push_back(traceback_walk<int32_t>(query, frame, composition_bias, target, d_begin, best, it, [&](TracebackMatrix<int32_t>::TracebackIterator &cell) {
+		const int col = cell.j - j0;
+		if (begin > 0 && col < begin + band) {
+			const int row = cell.i - (i0 + col);
+			begin = recompute(col + 1);
+			cell.score_ = &window[size_t(col - begin + 1) * band + row];
+		}
+	}));
 	return out;
 }
 
+/* Intra-sequence layout of the banded kernel: one target is aligned at a time, with the rows of a column spread over
+the lanes of a vector. The band geometry is that of a batch of the inter-sequence kernel with the given band, so that
+the computed matrix and the alignments are the same. */
+template<typename _traceback>
+list<Hsp> swipe_intra(
+	const sequence &query,
+	Frame frame,
+	const DpTarget &target,
+	int band,
+	const int32_t *profile,
+	const int8_t *composition_bias,
+	int score_cutoff,
+	DpStat &stat)
+{
+	typedef typename MatrixTag<int32_t, _traceback>::Type Matrix;
+
+	const int qlen = (int)query.length(), slen = (int)target.seq.length(), d_begin = target.d_end - band;
+	int i1 = std::max(target.d_end - 1, 0), i0 = i1 + 1 - band, pos = i1 - (target.d_end - 1);
+	const int cols = std::max(std::min(qlen - 1 - d_begin, slen - 1) + 1 - pos, 0);
+	if (std::is_same<_traceback, Traceback>::value && size_t(band) * (cols + 1) * sizeof(int32_t) > traceback_memory_limit())
+		return swipe_checkpointed(query, frame, target, band, profile, composition_bias, score_cutoff, stat);
+	Matrix dp(band, cols);
+
+	const int32_t open = score_matrix.gap_open() + score_matrix.gap_extend(), extend = score_matrix.gap_extend();
+	int32_t best = 0;
+	int max_col = 0, j = 0;
+
+	for (; pos < slen; ++pos) {
+		const int i0_ = std::max(i0, 0), i1_ = std::min(i1, qlen - 1);
+		if (i0_ > i1_)
+			break;
+		typename Matrix::ColumnIterator it(dp.begin(i0_ - i0, j));
+		if (i0_ - i0 > 0)
+			it.set_zero();
+
+		const int n = i1_ - i0_ + 1;
+		const int32_t col_best = intra_column(it.score_ptr_, profile + (int)target.seq[pos] * qlen + i0_, score_out(it), it.hgap_ptr_, n, open, extend);
+		stat.gross_cells += (n + INTRA_LANES - 1) / INTRA_LANES * INTRA_LANES;
+		stat.net_cells += n;
+		if (col_best > best) {
+			best = col_best;
+			max_col = j;
+		}
+		++i0;
+		++i1;
+		++j;
+	}
+
+	++stat.intra_targets;
+	list<Hsp> out;
+	if (best >= score_cutoff)
+		out.push_back(traceback<int32_t>(query, frame, composition_bias, dp, target, d_begin, best, max_col, 0, i0 - j, i1 - j));
+	return out;
+}
+
+template list<Hsp> swipe_intra<Traceback>(const sequence&, Frame, const DpTarget&, int, const int32_t*, const int8_t*, int, DpStat&);
+template list<Hsp> swipe_intra<ScoreOnly>(const sequence&, Frame, const DpTarget&, int, const int32_t*, const int8_t*, int, DpStat&);
+
 #ifdef __SSE2__
-template list<Hsp> swipe<score_vector<int16_t>, Traceback>(const sequence&, Frame, vector<DpTarget>::const_iterator, vector<DpTarget>::const_iterator, const int8_t*, int, vector<DpTarget> &overflow);
-template list<Hsp> swipe<score_vector<int16_t>, ScoreOnly>(const sequence&, Frame, vector<DpTarget>::const_iterator, vector<DpTarget>::const_iterator, const int8_t*, int, vector<DpTarget> &overflow);
+template list<Hsp> swipe<score_vector<int16_t>, Traceback>(const sequence&, Frame, vector<DpTarget>::const_iterator, vector<DpTarget>::const_iterator, const int8_t*, int, vector<DpTarget> &overflow, DpStat&);
+template list<Hsp> swipe<score_vector<int16_t>, ScoreOnly>(const sequence&, Frame, vector<DpTarget>::const_iterator, vector<DpTarget>::const_iterator, const int8_t*, int, vector<DpTarget> &overflow, DpStat&);
 #endif
-template list<Hsp> swipe<int32_t, Traceback>(const sequence&, Frame, vector<DpTarget>::const_iterator, vector<DpTarget>::const_iterator, const int8_t*, int, vector<DpTarget> &overflow);
-template list<Hsp> swipe<int32_t, ScoreOnly>(const sequence&, Frame, vector<DpTarget>::const_iterator, vector<DpTarget>::const_iterator, const int8_t*, int, vector<DpTarget> &overflow);
+template list<Hsp> swipe<int32_t, Traceback>(const sequence&, Frame, vector<DpTarget>::const_iterator, vector<DpTarget>::const_iterator, const int8_t*, int, vector<DpTarget> &overflow, DpStat&);
+template list<Hsp> swipe<int32_t, ScoreOnly>(const sequence&, Frame, vector<DpTarget>::const_iterator, vector<DpTarget>::const_iterator, const int8_t*, int, vector<DpTarget> &overflow, DpStat&);
 
 }}}
\ No newline at end of file
@@ -23,6 +23,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../score_vector_int8.h"
 #include "../../basic/value.h"
 
+BEGIN_DISPATCH_TYPES
+
 template<typename _sv>
 inline _sv cell_update_sv(const _sv &diagonal_cell,
 	const _sv &scores,
@@ -142,7 +144,8 @@ template<typename _sv>
 struct SwipeProfile
 {
 #ifdef __SSSE3__
-	inline void set(const __m128i &seq)
+	template<typename _seq>
+	inline void set(const _seq &seq)
 	{
 		assert(sizeof(data_) / sizeof(_sv) >= value_traits.alphabet_size);
 		_sv bias(score_matrix.bias());
@@ -169,7 +172,8 @@ struct SwipeProfile
 template<>
 struct SwipeProfile<score_vector<int8_t>>
 {
-	inline void set(const __m128i &seq)
+	template<typename _seq>
+	inline void set(const _seq &seq)
 	{
 		assert(sizeof(data_) / sizeof(score_vector<int8_t>) >= value_traits.alphabet_size);
 		for (unsigned j = 0; j < AMINO_ACID_COUNT; ++j)
@@ -206,4 +210,6 @@ struct SwipeProfile<int32_t>
 	const int32_t *row;
 };
 
+END_DISPATCH_TYPES
+
 #endif
\ No newline at end of file
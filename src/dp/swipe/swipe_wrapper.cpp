@@ -17,16 +17,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ****/
 
 #include <list>
-#include <atomic>
-#include <thread>
 #include <numeric>
+#include <algorithm>
 #include <limits.h>
 #include "../dp.h"
 #include "../score_vector_int16.h"
+#include "../../util/parallel/thread_pool.h"
 
 using std::list;
-using std::atomic;
-using std::thread;
 
 namespace DP { namespace BandedSwipe { namespace DISPATCH_ARCH {
 
@@ -38,7 +36,84 @@ list<Hsp> swipe(
 	vector<DpTarget>::const_iterator subject_end,
 	const int8_t *composition_bias,
 	int score_cutoff,
-	vector<DpTarget> &overflow);
+	vector<DpTarget> &overflow,
+	DpStat &stat);
+
+#ifdef __SSE4_1__
+#ifdef __AVX2__
+enum { INTRA_LANES = 8 };
+#else
+enum { INTRA_LANES = 4 };
+#endif
+#endif
+
+void build_intra_profile(const sequence &query, const int8_t *composition_bias, vector<int32_t> &out);
+
+template<typename _traceback>
+list<Hsp> swipe_intra(
+	const sequence &query,
+	Frame frame,
+	const DpTarget &target,
+	int band,
+	const int32_t *profile,
+	const int8_t *composition_bias,
+	int score_cutoff,
+	DpStat &stat);
+
+static int band(vector<DpTarget>::const_iterator begin, vector<DpTarget>::const_iterator end)
+{
+	int b = 0;
+	for (vector<DpTarget>::const_iterator i = begin; i < end; ++i)
+		b = std::max(b, i->d_end - i->d_begin);
+	return b;
+}
+
+// Size of the traceback matrix of the inter-sequence kernel for a batch, computed like in swipe() and TargetIterator.
+template<typename _sv>
+size_t traceback_matrix_size(vector<DpTarget>::const_iterator begin, vector<DpTarget>::const_iterator end, int qlen)
+{
+	const int b = band(begin, end);
+	int i1 = INT_MAX, cols = 0;
+	for (vector<DpTarget>::const_iterator i = begin; i < end; ++i)
+		i1 = std::min(i1, std::max(i->d_end - 1, 0));
+	for (vector<DpTarget>::const_iterator i = begin; i < end; ++i)
+		cols = std::max(cols, std::min(qlen - 1 - (i->d_end - b), (int)i->seq.length() - 1) + 1 - (i1 - (i->d_end - 1)));
+	return size_t(b) * (cols + 1) * sizeof(_sv);
+}
+
+/* Selects the kernel layout for a batch of targets. The inter-sequence kernel computes the band of all its lanes in
+every column, whether they hold a target or not, the intra-sequence kernel computes the band of each target in vectors
+of INTRA_LANES rows at about twice the cost per vector for resolving the vertical gaps. The latter wins for batches of
+few targets with wide bands. Batches whose traceback matrix exceeds the memory limit are always aligned target by
+target. */
+template<typename _sv>
+bool intra_layout(vector<DpTarget>::const_iterator begin, vector<DpTarget>::const_iterator end, int qlen, int flags)
+{
+	if ((flags & TRACEBACK) && traceback_matrix_size<_sv>(begin, end, qlen) > traceback_memory_limit())
+		return true;
+#ifdef __SSE4_1__
+	switch (config.swipe_layout) {
+	case Config::swipe_layout_inter:
+		return false;
+	case Config::swipe_layout_intra:
+		return true;
+	default:
+		const int b = band(begin, end);
+		return (end - begin) * 2 * ((b + INTRA_LANES - 1) / INTRA_LANES) <= b;
+	}
+#else
+	return false;
+#endif
+}
+
+template<typename _sv>
+bool intra_layout_used(vector<DpTarget>::const_iterator begin, vector<DpTarget>::const_iterator end, int qlen, int flags)
+{
+	for (vector<DpTarget>::const_iterator i = begin; i < end; i += ScoreTraits<_sv>::CHANNELS)
+		if (intra_layout<_sv>(i, i + std::min(vector<DpTarget>::const_iterator::difference_type(ScoreTraits<_sv>::CHANNELS), end - i), qlen, flags))
+			return true;
+	return false;
+}
 
 template<typename _sv>
 list<Hsp> swipe_targets(const sequence &query,
@@ -48,36 +123,47 @@ list<Hsp> swipe_targets(const sequence &query,
 	const int8_t *composition_bias,
 	int flags,
 	int score_cutoff,
-	vector<DpTarget> &overflow)
+	vector<DpTarget> &overflow,
+	const int32_t *intra_profile,
+	DpStat &stat)
 {
 	list<Hsp> out;
 	for (vector<DpTarget>::const_iterator i = begin; i < end; i += ScoreTraits<_sv>::CHANNELS) {
+		const vector<DpTarget>::const_iterator batch_end = i + std::min(vector<DpTarget>::const_iterator::difference_type(ScoreTraits<_sv>::CHANNELS), end - i);
+		if (intra_profile && intra_layout<_sv>(i, batch_end, (int)query.length(), flags)) {
+			const int b = band(i, batch_end);
+			for (vector<DpTarget>::const_iterator j = i; j < batch_end; ++j)
+				if (flags & TRACEBACK)
+					out.splice(out.end(), swipe_intra<Traceback>(query, frame, *j, b, intra_profile, composition_bias, score_cutoff, stat));
+				else
+					out.splice(out.end(), swipe_intra<ScoreOnly>(query, frame, *j, b, intra_profile, composition_bias, score_cutoff, stat));
+			continue;
+		}
 		if (flags & TRACEBACK)
-			out.splice(out.end(), swipe<_sv, Traceback>(query, frame, i, i + std::min(vector<DpTarget>::const_iterator::difference_type(ScoreTraits<_sv>::CHANNELS), end - i), composition_bias, score_cutoff, overflow));
+			out.splice(out.end(), swipe<_sv, Traceback>(query, frame, i, batch_end, composition_bias, score_cutoff, overflow, stat));
 		else
-			out.splice(out.end(), swipe<_sv, ScoreOnly>(query, frame, i, i + std::min(vector<DpTarget>::const_iterator::difference_type(ScoreTraits<_sv>::CHANNELS), end - i), composition_bias, score_cutoff, overflow));
+			out.splice(out.end(), swipe<_sv, ScoreOnly>(query, frame, i, batch_end, composition_bias, score_cutoff, overflow, stat));
 	}
 	return out;
 }
 
 template<typename _sv>
-void swipe_worker(const sequence *query,
+void swipe_worker(size_t i,
+	size_t thread_id,
+	const sequence *query,
 	vector<DpTarget>::const_iterator begin,
 	vector<DpTarget>::const_iterator end,
-	atomic<size_t> *next,
 	Frame frame,
 	const int8_t *composition_bias,
 	int flags,
 	int score_cutoff,
-	list<Hsp> *out,
-	vector<DpTarget> *overflow)
+	vector<list<Hsp>> *out,
+	vector<vector<DpTarget>> *overflow,
+	const int32_t *intra_profile,
+	vector<DpStat> *stat)
 {
-	DpStat stat;
-	size_t pos;
-	vector<DpTarget> of;
-	while (begin + (pos = next->fetch_add(ScoreTraits<_sv>::CHANNELS)) < end)
-		out->splice(out->end(), swipe_targets<_sv>(*query, begin + pos, std::min(begin + pos + ScoreTraits<_sv>::CHANNELS, end), frame, composition_bias, flags, score_cutoff, of));
-	*overflow = std::move(of);
+	const size_t pos = i * ScoreTraits<_sv>::CHANNELS;
+	(*out)[thread_id].splice((*out)[thread_id].end(), swipe_targets<_sv>(*query, begin + pos, std::min(begin + pos + ScoreTraits<_sv>::CHANNELS, end), frame, composition_bias, flags, score_cutoff, (*overflow)[thread_id], intra_profile, (*stat)[thread_id]));
 }
 
 template<typename _sv>
@@ -88,29 +174,34 @@ list<Hsp> swipe_threads(const sequence &query,
 	const int8_t *composition_bias,
 	int flags,
 	int score_cutoff,
-	vector<DpTarget> &overflow) {
+	vector<DpTarget> &overflow,
+	DpStat &stat) {
+	static thread_local vector<int32_t> profile;
+	const int32_t *intra_profile = nullptr;
+	if (intra_layout_used<_sv>(begin, end, (int)query.length(), flags)) {
+		build_intra_profile(query, composition_bias, profile);
+		intra_profile = profile.data();
+	}
 	if (flags & PARALLEL) {
 		task_timer timer("Banded swipe (run)", 3);
 		const size_t n = config.threads_;
-		vector<thread> threads;
 		vector<list<Hsp>> thread_out(n);
 		vector<vector<DpTarget>> thread_overflow(n);
-		atomic<size_t> next(0);
-		for (size_t i = 0; i < n; ++i)
-			threads.emplace_back(
-				swipe_worker<_sv>,
-				&query,
-				begin,
-				end,
-				&next,
-				frame,
-				composition_bias,
-				flags,
-				score_cutoff,
-				&thread_out[i],
-				&thread_overflow[i]);
-		for (auto &t : threads)
-			t.join();
+		vector<DpStat> thread_stat(n);
+		Util::Parallel::scheduled_thread_pool_auto(n,
+			(end - begin + ScoreTraits<_sv>::CHANNELS - 1) / ScoreTraits<_sv>::CHANNELS,
+			swipe_worker<_sv>,
+			&query,
+			begin,
+			end,
+			frame,
+			composition_bias,
+			flags,
+			score_cutoff,
+			&thread_out,
+			&thread_overflow,
+			intra_profile,
+			&thread_stat);
 		timer.go("Banded swipe (merge)");
 		list<Hsp> out;
 		for (list<Hsp> &l : thread_out)
@@ -118,27 +209,59 @@ list<Hsp> swipe_threads(const sequence &query,
 		overflow.reserve(std::accumulate(thread_overflow.begin(), thread_overflow.end(), (size_t)0, [](size_t n, const vector<DpTarget> &v) { return n + v.size(); }));
 		for (const vector<DpTarget> &v : thread_overflow)
 			overflow.insert(overflow.end(), v.begin(), v.end());
+		for (DpStat &s : thread_stat)
+			stat += s;
 		return out;
 	}
 	else
-		return swipe_targets<_sv>(query, begin, end, frame, composition_bias, flags, score_cutoff, overflow);
+		return swipe_targets<_sv>(query, begin, end, frame, composition_bias, flags, score_cutoff, overflow, intra_profile, stat);
 }
 
 
-list<Hsp> swipe(const sequence &query, vector<DpTarget>::iterator target_begin, vector<DpTarget>::iterator target_end, Frame frame, const Bias_correction *composition_bias, int flags, int score_cutoff)
+// Approximate column past the last cell of a target in its own band, counted like the start column left_i1().
+static int end_column(const DpTarget &t, int qlen)
+{
+	return t.left_i1() + std::min(qlen - t.d_begin, (int)t.seq.length());
+}
+
+/* Lane packing for --swipe-packing 1. The targets come sorted by start column, so that the targets of a batch enter it
+at about the same column. Within windows of a few batches, they are grouped by band width in steps of PACKING_BAND_STEP
+and reordered by their end column, so that a batch computes a band close to the ones of its targets and fewer lanes
+idle at its end. The windows keep the start columns of a batch close together. */
+template<typename _sv>
+void pack_targets(vector<DpTarget>::iterator begin, vector<DpTarget>::iterator end, int qlen)
+{
+	enum { PACKING_WINDOW = 4, PACKING_BAND_STEP = 16 };
+	const ptrdiff_t window = PACKING_WINDOW * ScoreTraits<_sv>::CHANNELS;
+	for (vector<DpTarget>::iterator i = begin; i < end; i += std::min(window, end - i))
+		std::stable_sort(i, i + std::min(window, end - i), [qlen](const DpTarget &a, const DpTarget &b) {
+			const int band_a = (a.d_end - a.d_begin) / PACKING_BAND_STEP, band_b = (b.d_end - b.d_begin) / PACKING_BAND_STEP;
+			return band_a < band_b || (band_a == band_b && end_column(a, qlen) < end_column(b, qlen));
+		});
+}
+
+list<Hsp> swipe(const sequence &query, vector<DpTarget>::iterator target_begin, vector<DpTarget>::iterator target_end, Frame frame, const Bias_correction *composition_bias, DpStat &stat, int flags, int score_cutoff)
 {
 	vector<DpTarget> overflow16, overflow32;
 #ifdef __SSE2__
 	task_timer timer("Banded swipe (sort)", flags & PARALLEL ? 3 : UINT_MAX);
 	list<Hsp> out;
 	std::stable_sort(target_begin, target_end);
+	// Targets whose expected score already saturates the 16 bit kernel are aligned with 32 bit scores right away
+	// instead of being recomputed after the 16 bit pass.
+	const int limit = ScoreTraits<score_vector<int16_t>>::int_score(ScoreTraits<score_vector<int16_t>>::max_score());
+	const vector<DpTarget>::iterator wide_begin = std::stable_partition(target_begin, target_end, [limit](const DpTarget &t) { return t.score_hint < limit; });
+	overflow16.assign(wide_begin, target_end);
+	stat.wide_targets += overflow16.size();
+	if (config.swipe_packing == Config::swipe_packing_grouped)
+		pack_targets<score_vector<int16_t>>(target_begin, wide_begin, (int)query.length());
 	timer.finish();
-	out = swipe_threads<score_vector<int16_t>>(query, target_begin, target_end, frame, composition_bias ? composition_bias->int8.data() : nullptr, flags, score_cutoff, overflow16);
+	out = swipe_threads<score_vector<int16_t>>(query, target_begin, wide_begin, frame, composition_bias ? composition_bias->int8.data() : nullptr, flags, score_cutoff, overflow16, stat);
 	if (!overflow16.empty())
-		out.splice(out.end(), swipe_threads<int32_t>(query, overflow16.begin(), overflow16.end(), frame, composition_bias ? composition_bias->int8.data() : nullptr, flags, score_cutoff, overflow32));
+		out.splice(out.end(), swipe_threads<int32_t>(query, overflow16.begin(), overflow16.end(), frame, composition_bias ? composition_bias->int8.data() : nullptr, flags, score_cutoff, overflow32, stat));
 	return out;
 #else
-	return swipe_threads<int32_t>(query, target_begin, target_end, frame, composition_bias ? composition_bias->int8.data() : nullptr, flags, score_cutoff, overflow32);
+	return swipe_threads<int32_t>(query, target_begin, target_end, frame, composition_bias ? composition_bias->int8.data() : nullptr, flags, score_cutoff, overflow32, stat);
 #endif
 }
 		
@@ -19,11 +19,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef TARGET_ITERATOR_H_
 #define TARGET_ITERATOR_H_
 
-// #define DP_STAT
-
 #include <stdint.h>
 #include "../dp.h"
 
+BEGIN_DISPATCH_TYPES
+
 template<int _n>
 struct TargetIterator
 {
@@ -32,6 +32,7 @@ struct TargetIterator
 		next(0),
 		n_targets(int(subject_end - subject_begin)),
 		cols(0),
+		live(0),
 		subject_begin(subject_begin)
 	{
 		for (; next < std::min(_n, n_targets); ++next) {
@@ -47,31 +48,30 @@ struct TargetIterator
 	char operator[](int channel)
 	{
 		if (pos[channel] >= 0) {
-#ifdef DP_STAT
 			++live;
-#endif
 			return subject_begin[target[channel]].seq[pos[channel]];
 		} else
 			return SUPER_HARD_MASK;
 	}
 
 #ifdef __SSSE3__
-	__m128i get()
+	typedef SIMD::Vector<(_n < 8 ? 8 : _n) * sizeof(int16_t)> SeqVector;
+
+	typename SeqVector::Type get()
 	{
-		int16_t s[8];
-#ifdef DP_STAT
+		int16_t s[_n < 8 ? 8 : _n];
 		live = 0;
-#endif
 		for (int i = 0; i < active.size(); ++i) {
 			const int channel = active[i];
 			s[channel] = (*this)[channel];
 		}
-		return _mm_loadu_si128((const __m128i*)s);
+		return SeqVector::loadu(s);
 	}
 #else
 	uint64_t get()
 	{
 		uint64_t dst = 0;
+		live = 0;
 		for (int i = 0; i < active.size(); ++i) {
 			const int channel = active[i];
 			dst |= uint64_t((*this)[channel]) << (8 * channel);
@@ -100,9 +100,8 @@ struct TargetIterator
 	}
 
 	int pos[_n], target[_n], next, n_targets, cols;
-#ifdef DP_STAT
+	// Number of channels that held a letter of their target in the last vector returned by get().
 	int live;
-#endif
 	Static_vector<int, _n> active;
 	const vector<DpTarget>::const_iterator subject_begin;
 };
@@ -114,6 +113,7 @@ struct TargetBuffer
 	TargetBuffer(const sequence *subject_begin, const sequence *subject_end) :
 		next(0),
 		n_targets(int(subject_end - subject_begin)),
+		live(0),
 		subject_begin(subject_begin)
 	{
 		for (; next < std::min(_n, n_targets); ++next) {
@@ -123,16 +123,10 @@ struct TargetBuffer
 		}
 	}
 
-#ifdef DP_STAT
 	char operator[](int channel)
-#else
-	char operator[](int channel) const
-#endif
 	{
 		if (pos[channel] >= 0) {
-#ifdef DP_STAT
 			++live;
-#endif
 			return subject_begin[target[channel]][pos[channel]];
 		}
 		else
@@ -140,23 +134,22 @@ struct TargetBuffer
 	}
 
 #ifdef __SSSE3__
-#ifdef DP_STAT
-	template<typename _t> __m128i seq_vector(const _t&)
-#else
-	template<typename _t> __m128i seq_vector(const _t&) const
-#endif	
+	template<typename _t> typename SIMD::Vector<(_n * sizeof(_t) < 16 ? 16 : _n * sizeof(_t))>::Type seq_vector(const _t&)
 	{
-		_t s[_n];
+		typedef SIMD::Vector<(_n * sizeof(_t) < 16 ? 16 : _n * sizeof(_t))> SeqVector;
+		_t s[sizeof(typename SeqVector::Type) / sizeof(_t)];
+		live = 0;
 		for (int i = 0; i < active.size(); ++i) {
 			const int channel = active[i];
 			s[channel] = (*this)[channel];
 		}
-		return _mm_loadu_si128((const __m128i*)s);
+		return SeqVector::loadu(s);
 	}
 #else
 	template<typename _t> uint64_t seq_vector(const _t&)
 	{
 		uint64_t dst = 0;
+		live = 0;
 		for (int i = 0; i < active.size(); ++i) {
 			const int channel = active[i];
 			dst |= uint64_t((*this)[channel]) << (8 * channel);
@@ -185,11 +178,11 @@ struct TargetBuffer
 	}
 
 	int pos[_n], target[_n], next, n_targets, cols;
-#ifdef DP_STAT
 	int live;
-#endif
 	Static_vector<int, _n> active;
 	const sequence *subject_begin;
 };
 
+END_DISPATCH_TYPES
+
 #endif
\ No newline at end of file
@@ -4,11 +4,14 @@
 #include "../basic/value.h"
 #include "../basic/diagonal_segment.h"
 #include "comp_based_stats.h"
+#include "../util/simd.h"
 
 int xdrop_ungapped(const Letter *query, const Letter *subject, unsigned seed_len, unsigned &delta, unsigned &len);
 int xdrop_ungapped(const Letter *query, const Letter *subject, unsigned &delta, unsigned &len);
 int xdrop_ungapped_right(const Letter *query, const Letter *subject, int &len);
 Diagonal_segment xdrop_ungapped(const sequence &query, const Bias_correction &query_bc, const sequence &subject, int qa, int sa);
 Diagonal_segment xdrop_ungapped(const sequence &query, const sequence &subject, int qa, int sa);
+// Computes xdrop_ungapped(query, subject, qa[i], sa[i]) for i < n, extending several diagonals at once.
+DECL_DISPATCH(void, xdrop_ungapped_batch, (const sequence &query, const sequence &subject, const int *qa, const int *sa, size_t n, Diagonal_segment *out))
 
 #endif
\ No newline at end of file
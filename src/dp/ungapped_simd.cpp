@@ -0,0 +1,190 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+                        Eberhard Karls Universitaet Tuebingen
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <algorithm>
+#include <limits.h>
+#include "ungapped.h"
+#include "../basic/score_matrix.h"
+#include "../basic/config.h"
+#include "../util/simd/transpose.h"
+
+namespace DISPATCH_ARCH {
+
+#ifdef __SSE2__
+
+namespace {
+
+#ifdef __AVX2__
+
+typedef __m256i Vec;
+inline Vec set1(int x) { return _mm256_set1_epi16((short)x); }
+inline Vec load(const int16_t *p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+inline void store(int16_t *p, Vec v) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), v); }
+inline Vec adds(Vec a, Vec b) { return _mm256_adds_epi16(a, b); }
+inline Vec subs(Vec a, Vec b) { return _mm256_subs_epi16(a, b); }
+inline Vec max(Vec a, Vec b) { return _mm256_max_epi16(a, b); }
+inline Vec cmpgt(Vec a, Vec b) { return _mm256_cmpgt_epi16(a, b); }
+inline Vec cmpeq(Vec a, Vec b) { return _mm256_cmpeq_epi16(a, b); }
+inline Vec vand(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+inline Vec vandnot(Vec a, Vec b) { return _mm256_andnot_si256(a, b); }
+inline Vec vor(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+inline unsigned movemask(Vec a) { return (unsigned)_mm256_movemask_epi8(a); }
+inline Vec widen(__m128i a) { return _mm256_cvtepi8_epi16(a); }
+
+#else
+
+typedef __m128i Vec;
+inline Vec set1(int x) { return _mm_set1_epi16((short)x); }
+inline Vec load(const int16_t *p) { return _mm_load_si128(reinterpret_cast<const __m128i*>(p)); }
+inline void store(int16_t *p, Vec v) { _mm_store_si128(reinterpret_cast<__m128i*>(p), v); }
+inline Vec adds(Vec a, Vec b) { return _mm_adds_epi16(a, b); }
+inline Vec subs(Vec a, Vec b) { return _mm_subs_epi16(a, b); }
+inline Vec max(Vec a, Vec b) { return _mm_max_epi16(a, b); }
+inline Vec cmpgt(Vec a, Vec b) { return _mm_cmpgt_epi16(a, b); }
+inline Vec cmpeq(Vec a, Vec b) { return _mm_cmpeq_epi16(a, b); }
+inline Vec vand(Vec a, Vec b) { return _mm_and_si128(a, b); }
+inline Vec vandnot(Vec a, Vec b) { return _mm_andnot_si128(a, b); }
+inline Vec vor(Vec a, Vec b) { return _mm_or_si128(a, b); }
+inline unsigned movemask(Vec a) { return (unsigned)_mm_movemask_epi8(a); }
+inline Vec widen(__m128i a) { return _mm_srai_epi16(_mm_unpacklo_epi8(a, a), 8); }
+
+#endif
+
+enum { CHANNELS = sizeof(Vec) / sizeof(int16_t), BLOCK = 16, STEP_LIMIT = 32000, SCORE_LIMIT = 30000 };
+const int8_t SENTINEL = -128;
+
+#ifdef __AVX2__
+
+// Looks up the substitution scores of BLOCK steps of one diagonal with two gathers from the 32 bit score matrix.
+inline void lane_scores(const Letter *q, const Letter *s, ptrdiff_t dir, int8_t *out)
+{
+	const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), delimiter = _mm_set1_epi8(sequence::DELIMITER);
+	__m128i ql, sl;
+	if (dir > 0) {
+		ql = _mm_loadu_si128(reinterpret_cast<const __m128i*>(q));
+		sl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+	}
+	else {
+		ql = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(q - BLOCK + 1)), reverse);
+		sl = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s - BLOCK + 1)), reverse);
+	}
+	const int *matrix = score_matrix.matrix32();
+	const __m256i i0 = _mm256_add_epi32(_mm256_slli_epi32(_mm256_cvtepi8_epi32(ql), 5), _mm256_cvtepi8_epi32(sl)),
+		i1 = _mm256_add_epi32(_mm256_slli_epi32(_mm256_cvtepi8_epi32(_mm_srli_si128(ql, 8)), 5), _mm256_cvtepi8_epi32(_mm_srli_si128(sl, 8)));
+	const __m256i v0 = _mm256_i32gather_epi32(matrix, i0, 4), v1 = _mm256_i32gather_epi32(matrix, i1, 4);
+	const __m256i v16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(v0, v1), 0xd8);
+	__m128i v = _mm_packs_epi16(_mm256_castsi256_si128(v16), _mm256_extracti128_si256(v16, 1));
+	const __m128i d = _mm_or_si128(_mm_cmpeq_epi8(ql, delimiter), _mm_cmpeq_epi8(sl, delimiter));
+	v = _mm_blendv_epi8(v, _mm_set1_epi8(SENTINEL), d);
+	_mm_store_si128(reinterpret_cast<__m128i*>(out), v);
+}
+
+#endif
+
+// Extends the diagonals of the lanes in active (2 bits per lane as returned by movemask) in direction dir, starting
+// at the letters q[k], s[k]. The substitution scores of BLOCK steps are looked up per lane without branches and
+// transposed to one vector per step, so that the x-drop test and the tracking of the best score run over all lanes at
+// once. Letters up to BLOCK positions past a delimiter are read but not used. On return, score holds the best scores
+// and pos the number of letters up to the best score. Returns the lanes that were still active after STEP_LIMIT steps.
+unsigned extend(const Letter **q, const Letter **s, unsigned active, ptrdiff_t dir, Vec &score, Vec &pos)
+{
+	alignas(16) int8_t lanes[16 * BLOCK], steps[BLOCK * 16];
+	const Vec xdrop = set1(config.raw_ungapped_xdrop), sentinel = set1(SENTINEL);
+	Vec st = score, a = set1(-1);
+	pos = set1(0);
+	// The transpose always reads 16 rows, the rows beyond CHANNELS are never written by the loop.
+	std::fill(lanes + CHANNELS * BLOCK, lanes + 16 * BLOCK, SENTINEL);
+	for (int i = 1; active != 0 && i < STEP_LIMIT; i += BLOCK) {
+		for (unsigned k = 0; k < CHANNELS; ++k) {
+			int8_t *out = &lanes[k * BLOCK];
+			if (active & (1u << (2 * k))) {
+#ifdef __AVX2__
+				lane_scores(q[k], s[k], dir, out);
+				q[k] += dir * BLOCK;
+				s[k] += dir * BLOCK;
+#else
+				const int8_t *matrix = score_matrix.matrix8();
+				const Letter *ql = q[k], *sl = s[k];
+				for (unsigned t = 0; t < BLOCK; ++t, ql += dir, sl += dir) {
+					const int8_t v = matrix[(int(*ql) << 5) + int(*sl)];
+					out[t] = (*ql == sequence::DELIMITER || *sl == sequence::DELIMITER) ? SENTINEL : v;
+				}
+				q[k] = ql;
+				s[k] = sl;
+#endif
+			}
+			else
+				std::fill(out, out + BLOCK, SENTINEL);
+		}
+		transpose((char*)lanes, (char*)steps, 0);
+		for (unsigned t = 0; t < BLOCK; ++t) {
+			const Vec v = widen(_mm_load_si128(reinterpret_cast<const __m128i*>(&steps[t * 16])));
+			a = vandnot(cmpeq(v, sentinel), vand(a, cmpgt(xdrop, subs(score, st))));
+			st = adds(st, vand(v, a));
+			const Vec improved = vand(a, cmpgt(st, score));
+			score = max(score, st);
+			pos = vor(vandnot(improved, pos), vand(improved, set1(i + (int)t)));
+		}
+		active = movemask(a);
+	}
+	return active;
+}
+
+}
+
+void xdrop_ungapped_batch(const sequence &query, const sequence &subject, const int *qa, const int *sa, size_t n, Diagonal_segment *out)
+{
+	alignas(32) int16_t score[CHANNELS], delta[CHANNELS], len[CHANNELS];
+	const Letter *q[CHANNELS], *s[CHANNELS];
+	for (size_t i = 0; i < n; i += CHANNELS) {
+		const unsigned m = (unsigned)std::min(n - i, (size_t)CHANNELS), lanes = m == CHANNELS ? UINT_MAX : (1u << (2 * m)) - 1;
+		for (unsigned k = 0; k < m; ++k) {
+			q[k] = query.data() + qa[i + k] - 1;
+			s[k] = subject.data() + sa[i + k] - 1;
+		}
+		Vec best = set1(0), d, l;
+		unsigned overflow = extend(q, s, lanes, -1, best, d);
+		for (unsigned k = 0; k < m; ++k) {
+			q[k] = query.data() + qa[i + k];
+			s[k] = subject.data() + sa[i + k];
+		}
+		overflow |= extend(q, s, lanes, 1, best, l);
+		store(score, best);
+		store(delta, d);
+		store(len, l);
+		for (unsigned k = 0; k < m; ++k)
+			if ((overflow & (1u << (2 * k))) || score[k] >= SCORE_LIMIT)
+				out[i + k] = xdrop_ungapped(query, subject, qa[i + k], sa[i + k]);
+			else
+				out[i + k] = Diagonal_segment(qa[i + k] - delta[k], sa[i + k] - delta[k], len[k] + delta[k], score[k]);
+	}
+}
+
+#else
+
+void xdrop_ungapped_batch(const sequence &query, const sequence &subject, const int *qa, const int *sa, size_t n, Diagonal_segment *out)
+{
+	for (size_t i = 0; i < n; ++i)
+		out[i] = xdrop_ungapped(query, subject, qa[i], sa[i]);
+}
+
+#endif
+
+}
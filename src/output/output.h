@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <memory>
 #include <map>
 #include <mutex>
+#include <condition_variable>
 #include "../util/io/output_file.h"
 #include "../basic/packed_transcript.h"
 #include "../util/text_buffer.h"
@@ -117,16 +118,23 @@ struct IntermediateRecord
 
 void join_blocks(unsigned ref_blocks, Consumer &master_out, const PtrVector<TempFile> &tmp_file, const Parameters &params, const Metadata &metadata, DatabaseFile &db_file);
 
+// Writes the per-query output buffers in query order. Out-of-order buffers are kept in a ring indexed by query number
+// that holds at most `capacity` queries; producers that run further ahead are stalled until the gap is closed.
 struct OutputSink
 {
-	OutputSink(size_t begin, Consumer *f) :
+	OutputSink(size_t begin, Consumer *f, size_t capacity = 4096) :
 		f_(f),
+		capacity_(capacity),
+		ring_(capacity),
 		begin_(begin),
 		next_(begin),
 		size_(0),
 		max_size_(0)
 	{}
+	~OutputSink();
 	void push(size_t n, TextBuffer *buf);
+	// Returns an empty buffer, reusing the allocation of a previously written one if possible.
+	TextBuffer* get_buffer();
 	size_t size() const
 	{
 		return size_;
@@ -148,10 +156,23 @@ struct OutputSink
 	}
 	static std::unique_ptr<OutputSink> instance;
 private:
-	void flush(TextBuffer *buf);
-	std::mutex mtx_;
+	struct Slot {
+		Slot():
+			filled(false),
+			buf(nullptr)
+		{}
+		bool filled;
+		TextBuffer *buf;
+	};
+	enum : size_t { MAX_POOLED_ALLOC = 1 << 20 };
+	void flush(TextBuffer *buf, std::unique_lock<std::mutex> &lock);
+	void recycle(std::vector<TextBuffer*> &buffers);
+	std::mutex mtx_, pool_mtx_;
+	std::condition_variable space_cv_;
 	Consumer* const f_;
-	std::map<size_t, TextBuffer*> backlog_;
+	const size_t capacity_;
+	std::vector<Slot> ring_;
+	std::vector<TextBuffer*> pool_;
 	size_t begin_, next_, size_, max_size_;
 };
 
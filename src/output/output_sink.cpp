@@ -27,48 +27,87 @@ using std::chrono::duration_cast;
 
 std::unique_ptr<OutputSink> OutputSink::instance;
 
+OutputSink::~OutputSink()
+{
+	for (TextBuffer *buf : pool_)
+		delete buf;
+	for (Slot &s : ring_)
+		delete s.buf;
+}
+
+TextBuffer* OutputSink::get_buffer()
+{
+	{
+		std::lock_guard<std::mutex> lock(pool_mtx_);
+		if (!pool_.empty()) {
+			TextBuffer *buf = pool_.back();
+			pool_.pop_back();
+			return buf;
+		}
+	}
+	return new TextBuffer;
+}
+
+void OutputSink::recycle(vector<TextBuffer*> &buffers)
+{
+	std::lock_guard<std::mutex> lock(pool_mtx_);
+	for (TextBuffer *buf : buffers) {
+		if (buf == nullptr)
+			continue;
+		if (pool_.size() < capacity_ && buf->alloc_size() <= MAX_POOLED_ALLOC) {
+			buf->clear();
+			pool_.push_back(buf);
+		}
+		else
+			delete buf;
+	}
+}
+
 void OutputSink::push(size_t n, TextBuffer *buf)
 {
-	mtx_.lock();
-	//cout << "n=" << n << " next=" << next_ << endl;
+	std::unique_lock<std::mutex> lock(mtx_);
+	while (n >= next_ + capacity_)
+		space_cv_.wait(lock);
 	if (n != next_) {
-		backlog_[n] = buf;
+		Slot &slot = ring_[n % capacity_];
+		slot.filled = true;
+		slot.buf = buf;
 		size_ += buf ? buf->alloc_size() : 0;
 		max_size_ = std::max(max_size_, size_);
-		mtx_.unlock();
 	}
 	else
-		flush(buf);
+		flush(buf, lock);
 }
 
-void OutputSink::flush(TextBuffer *buf)
+void OutputSink::flush(TextBuffer *buf, std::unique_lock<std::mutex> &lock)
 {
 	size_t n = next_ + 1;
 	vector<TextBuffer*> out;
 	out.push_back(buf);
-	std::map<size_t, TextBuffer*>::iterator i;
 	do {
-		while ((i = backlog_.begin()) != backlog_.end() && i->first == n) {
-			out.push_back(i->second);
-			backlog_.erase(i);
+		Slot *slot;
+		while ((slot = &ring_[n % capacity_])->filled) {
+			out.push_back(slot->buf);
+			*slot = Slot();
 			++n;
 		}
-		mtx_.unlock();
+		lock.unlock();
 		size_t size = 0;
 		for (vector<TextBuffer*>::iterator j = out.begin(); j < out.end(); ++j) {
 			if (*j) {
 				f_->consume((*j)->get_begin(), (*j)->size());
 				if (*j != buf)
 					size += (*j)->alloc_size();
-				delete *j;
 			}
 		}
+		recycle(out);
 		out.clear();
-		mtx_.lock();
+		lock.lock();
 		size_ -= size;
-	} while ((i = backlog_.begin()) != backlog_.end() && i->first == n);
+	} while (ring_[n % capacity_].filled);
 	next_ = n;
-	mtx_.unlock();
+	lock.unlock();
+	space_cv_.notify_all();
 }
 
 void heartbeat_worker(size_t qend)
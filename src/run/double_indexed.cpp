@@ -19,6 +19,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <thread>
+#include <exception>
 #include "../data/reference.h"
 #include "../data/queries.h"
 #include "../basic/statistics.h"
@@ -27,16 +29,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../data/load_seqs.h"
 #include "../output/output_format.h"
 #include "../data/frequent_seeds.h"
+#include "../data/seed_partition_cache.h"
+#include "../data/query_cache.h"
 #include "../output/daa_write.h"
 #include "../data/taxonomy.h"
 #include "../basic/masking.h"
 #include "../data/ref_dictionary.h"
 #include "../data/metadata.h"
+#include "../data/seed_index.h"
 #include "../search/search.h"
 #include "workflow.h"
 #include "../util/io/consumer.h"
 #include "../util/parallel/thread_pool.h"
 #include "../util/system/system.h"
+#include "../util/system/numa.h"
 
 using namespace std;
 
@@ -50,43 +56,50 @@ void run_ref_chunk(DatabaseFile &db_file,
 	PtrVector<TempFile> &tmp_file,
 	const Parameters &params,
 	const Metadata &metadata,
-	const vector<unsigned> &block_to_database_id)
+	const vector<unsigned> &block_to_database_id,
+	SeedIndex *seed_index)
 {
 	log_rss();
 
 	task_timer timer;
-	if (config.masking == 1) {
-		timer.go("Masking reference");
-		size_t n = mask_seqs(*ref_seqs::data_, Masking::get());
-		timer.finish();
-		log_stream << "Masked letters: " << n << endl;
-	}
-
 	ReferenceDictionary::get().init(safe_cast<unsigned>(ref_seqs::get().get_length()), block_to_database_id);
 
 	timer.go("Initializing temporary storage");
 	Trace_pt_buffer::instance = new Trace_pt_buffer(query_seqs::data_->get_length() / align_mode.query_contexts,
 		config.tmpdir,
-		config.query_bins);
+		config.query_bins,
+		config.trace_pt_mem_budget());
 
 	if (!config.swipe_all) {
-		timer.go("Building reference histograms");
-		if (config.algo == Config::query_indexed)
-			ref_hst = Partitioned_histogram(*ref_seqs::data_, false, query_seeds);
-		else if (query_seeds_hashed != 0)
-			ref_hst = Partitioned_histogram(*ref_seqs::data_, true, query_seeds_hashed);
-		else
-			ref_hst = Partitioned_histogram(*ref_seqs::data_, false, &no_filter);
-
-		timer.go("Allocating buffers");
-		char *ref_buffer = SeedArray::alloc_buffer(ref_hst);	
+		char *ref_buffer = nullptr;
+		if (seed_index) {
+			timer.go("Mapping reference seed index");
+			seed_index->map_block(current_ref_block, *ref_seqs::data_);
+		}
+		else {
+			timer.go("Building reference histograms");
+			if (query_seeds_bloom != 0)
+				ref_hst = Partitioned_histogram(*ref_seqs::data_, false, query_seeds_bloom, config.minimizer_window);
+			else if (config.algo == Config::query_indexed)
+				ref_hst = Partitioned_histogram(*ref_seqs::data_, false, query_seeds, config.minimizer_window);
+			else if (query_seeds_hashed != 0)
+				ref_hst = Partitioned_histogram(*ref_seqs::data_, true, query_seeds_hashed, config.minimizer_window);
+			else
+				ref_hst = Partitioned_histogram(*ref_seqs::data_, false, &no_filter, config.minimizer_window);
+
+			timer.go("Allocating buffers");
+			ref_buffer = SeedArray::alloc_buffer(ref_hst);
+		}
 		timer.finish();
 
 		for (unsigned i = 0; i < shapes.count(); ++i)
-			search_shape(i, query_chunk, query_buffer, ref_buffer);
+			search_shape(i, query_chunk, query_buffer, ref_buffer, seed_index);
 
 		timer.go("Deallocating buffers");
 		delete[] ref_buffer;
+		seed_partition_cache.clear();
+		if (seed_index)
+			seed_index->unmap();
 	}
 
 	Consumer* out;
@@ -111,13 +124,57 @@ void run_ref_chunk(DatabaseFile &db_file,
 	timer.finish();
 }
 
+struct RefBlock
+{
+	RefBlock() :
+		seqs(nullptr),
+		ids(nullptr),
+		loaded(false),
+		blocked(false),
+		masked_letters(0)
+	{}
+	Sequence_set *seqs;
+	String_set<0> *ids;
+	vector<unsigned> block_to_database_id;
+	bool loaded, blocked;
+	size_t masked_letters;
+	std::exception_ptr error;
+};
+
+/* Loads and masks the next reference block. On the prefetch thread (background), nothing is logged and the block is
+masked by the calling thread alone, so that the thread pool stays with the search of the current block. Global state
+like blocked_processing is only set by the main thread after the block has been taken over. */
+void load_ref_block(DatabaseFile *db_file, const vector<bool> *filter, RefBlock *block, bool background)
+{
+	try {
+		task_timer timer("Loading reference sequences", background ? UINT_MAX : 1);
+		block->loaded = db_file->load_seqs(block->block_to_database_id,
+			(size_t)(config.chunk_size*1e9),
+			&block->seqs,
+			&block->ids,
+			true,
+			filter,
+			&block->blocked);
+		if (block->loaded && config.masking == 1) {
+			timer.go("Masking reference");
+			block->masked_letters = mask_seqs(*block->seqs, Masking::get(), true, background ? 1 : 0);
+		}
+		if (block->loaded)
+			Numa::interleave(block->seqs->data(), block->seqs->raw_len() + Sequence_set::PERIMETER_PADDING);
+	}
+	catch (...) {
+		block->error = std::current_exception();
+	}
+}
+
 void run_query_chunk(DatabaseFile &db_file,
 	unsigned query_chunk,
 	Consumer &master_out,
 	OutputFile *unaligned_file,
 	OutputFile *aligned_file,
 	const Metadata &metadata,
-	const Options &options)
+	const Options &options,
+	SeedIndex *seed_index)
 {
 	const Parameters params(db_file.ref_header.sequences, db_file.ref_header.letters);
 
@@ -125,29 +182,53 @@ void run_query_chunk(DatabaseFile &db_file,
 	if (query_chunk == 0)
 		setup_search_cont();
 	if (config.algo == -1) {
-		query_seeds = new Seed_set(query_seqs::get(), SINGLE_INDEXED_SEED_SPACE_MAX_COVERAGE);
+		double coverage;
+		if (config.bloom_fpr > 0) {
+			query_seeds_bloom = new Bloom_seed_set(query_seqs::get(), config.bloom_fpr, SINGLE_INDEXED_SEED_SPACE_MAX_COVERAGE);
+			coverage = query_seeds_bloom->coverage();
+		}
+		else {
+			query_seeds = new Seed_set(query_seqs::get(), SINGLE_INDEXED_SEED_SPACE_MAX_COVERAGE);
+			coverage = query_seeds->coverage();
+		}
 		timer.finish();
-		log_stream << "Seed space coverage = " << query_seeds->coverage() << endl;
-		if (use_single_indexed(query_seeds->coverage(), query_seqs::get().letters(), db_file.ref_header.letters))
+		log_stream << "Seed space coverage = " << coverage << endl;
+		if (use_single_indexed(coverage, query_seqs::get().letters(), db_file.ref_header.letters))
 			config.algo = Config::query_indexed;
 		else {
 			config.algo = Config::double_indexed;
 			delete query_seeds;
 			query_seeds = NULL;
+			delete query_seeds_bloom;
+			query_seeds_bloom = NULL;
 		}
 	}
 	else if (config.algo == Config::query_indexed) {
-		query_seeds = new Seed_set(query_seqs::get(), 2);
+		double coverage;
+		if (config.bloom_fpr > 0) {
+			query_seeds_bloom = new Bloom_seed_set(query_seqs::get(), config.bloom_fpr, 2);
+			coverage = query_seeds_bloom->coverage();
+		}
+		else {
+			query_seeds = new Seed_set(query_seqs::get(), 2);
+			coverage = query_seeds->coverage();
+		}
 		timer.finish();
-		log_stream << "Seed space coverage = " << query_seeds->coverage() << endl;
+		log_stream << "Seed space coverage = " << coverage << endl;
 	}
 	else
 		timer.finish();
 	if (query_chunk == 0)
 		setup_search();
 	if (config.algo == Config::double_indexed && config.small_query) {
-		timer.go("Building query seed hash set");
-		query_seeds_hashed = new Hashed_seed_set(query_seqs::get());
+		if (config.bloom_fpr > 0) {
+			timer.go("Building query seed Bloom filter");
+			query_seeds_bloom = new Bloom_seed_set(query_seqs::get(), config.bloom_fpr, 2);
+		}
+		else {
+			timer.go("Building query seed hash set");
+			query_seeds_hashed = new Hashed_seed_set(query_seqs::get());
+		}
 	}
 	timer.finish();
 
@@ -169,19 +250,52 @@ void run_query_chunk(DatabaseFile &db_file,
 	query_aligned.insert(query_aligned.end(), query_ids::get().get_length(), false);
 	db_file.rewind();
 	vector<unsigned> block_to_database_id;
-
-	for (current_ref_block = 0; db_file.load_seqs(block_to_database_id,
-		(size_t)(config.chunk_size*1e9),
-		&ref_seqs::data_,
-		&ref_ids::data_,
-		true,
-		options.db_filter ? options.db_filter : metadata.taxon_filter); ++current_ref_block)
-		run_ref_chunk(db_file, query_chunk, query_len_bounds, query_buffer, master_out, tmp_file, params, metadata, block_to_database_id);
+	const vector<bool> *db_filter = options.db_filter ? options.db_filter : metadata.taxon_filter;
+	// The next block is loaded and masked by a single background thread while the current one is processed, at the cost of holding two blocks in memory.
+	const bool prefetch = config.prefetch_size > 0.0 && config.chunk_size <= config.prefetch_size;
+	RefBlock next;
+
+	if (config.query_cache)
+		query_cache.init(query_ids::get().get_length());
+
+	load_ref_block(&db_file, db_filter, &next, false);
+	for (current_ref_block = 0; ; ++current_ref_block) {
+		if (next.error)
+			std::rethrow_exception(next.error);
+		if (!next.loaded)
+			break;
+		ref_seqs::data_ = next.seqs;
+		ref_ids::data_ = next.ids;
+		block_to_database_id = std::move(next.block_to_database_id);
+		blocked_processing = next.blocked;
+		ref_seqs::data_->print_stats();
+		if (config.masking == 1)
+			log_stream << "Masked letters: " << next.masked_letters << endl;
+		next = RefBlock();
+		std::thread prefetch_thread;
+		if (prefetch)
+			prefetch_thread = std::thread(load_ref_block, &db_file, db_filter, &next, true);
+		try {
+			run_ref_chunk(db_file, query_chunk, query_len_bounds, query_buffer, master_out, tmp_file, params, metadata, block_to_database_id, seed_index);
+		}
+		catch (...) {
+			if (prefetch_thread.joinable())
+				prefetch_thread.join();
+			throw;
+		}
+		if (prefetch)
+			prefetch_thread.join();
+		else
+			load_ref_block(&db_file, db_filter, &next, false);
+	}
 
 	timer.go("Deallocating buffers");
 	delete[] query_buffer;
+	query_cache.clear();
 	delete query_seeds;
 	query_seeds = 0;
+	delete query_seeds_bloom;
+	query_seeds_bloom = 0;
 
 	log_rss();
 
@@ -208,7 +322,7 @@ void run_query_chunk(DatabaseFile &db_file,
 		ReferenceDictionary::get().clear();
 }
 
-void master_thread(DatabaseFile *db_file, task_timer &total_timer, Metadata &metadata, const Options &options)
+void master_thread(DatabaseFile *db_file, task_timer &total_timer, Metadata &metadata, const Options &options, SeedIndex *seed_index)
 {
 	task_timer timer("Opening the input file", true);
 	TextInputFile *query_file = nullptr;
@@ -268,7 +382,7 @@ void master_thread(DatabaseFile *db_file, task_timer &total_timer, Metadata &met
 			timer.finish();
 		}
 
-		run_query_chunk(*db_file, current_query_chunk, *master_out, unaligned_file.get(), aligned_file.get(), metadata, options);
+		run_query_chunk(*db_file, current_query_chunk, *master_out, unaligned_file.get(), aligned_file.get(), metadata, options, seed_index);
 	}
 
 	if (query_file && !options.query_file) {
@@ -379,7 +493,17 @@ void run(const Options &options)
 		timer.finish();
 	}
 
-	master_thread(db_file, total, metadata, options);
+	unique_ptr<SeedIndex> seed_index;
+	if (config.seed_index) {
+		if (options.self || options.db_filter || taxon_filter)
+			throw std::runtime_error("--seed-index is not supported for filtered databases.");
+		timer.go("Opening the seed index");
+		seed_index.reset(new SeedIndex(SeedIndex::file_name(config.database)));
+		seed_index->check(*db_file);
+		timer.finish();
+	}
+
+	master_thread(db_file, total, metadata, options, seed_index.get());
 }
 
 }}
\ No newline at end of file
@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../basic/config.h"
 #include "tools.h"
 #include "../data/reference.h"
+#include "../data/seed_index.h"
 #include "workflow.h"
 #include "../util/simd.h"
 #ifdef EXTRA
@@ -76,6 +77,9 @@ int main(int ac, const char* av[])
 		case Config::makedb:
 			make_db();
 			break;
+		case Config::makeidx:
+			make_seed_index();
+			break;
 		case Config::blastp:
 		case Config::blastx:
 			Workflow::Search::run(Workflow::Search::Options());
@@ -20,6 +20,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "collision.h"
 #include "seed_complexity.h"
 #include "finger_print.h"
+#include "../data/seed_partition_cache.h"
+#include "../util/hash_function.h"
 
 // #define NO_COLLISION_FILTER
 
@@ -27,8 +29,11 @@ namespace DISPATCH_ARCH {
 
 bool verify_hit(const Letter *query, const Letter *subject, unsigned sid)
 {
-	const Finger_print fq(query), fs(subject);
-	if (fq.match(fs) < config.min_identities)
+	if (config.finger_print == Config::finger_print_reduced) {
+		if (Reduced_finger_print_48(query).match(Reduced_finger_print_48(subject)) < config.min_identities)
+			return false;
+	}
+	else if (Finger_print(query).match(Finger_print(subject)) < config.min_identities)
 		return false;
 	return true;
 	unsigned delta, len;
@@ -42,6 +47,8 @@ inline bool match_shape_mask(const uint64_t mask, const uint64_t shape_mask)
 
 inline bool is_lower_chunk(const Letter *subject, unsigned sid)
 {
+	if (seed_partition_cache.enabled(sid))
+		return current_range.lower(Seed_partition_cache::partition(seed_partition_cache.get(subject, sid)));
 	Packed_seed seed;
 	if (config.algo == Config::double_indexed)
 		shapes[sid].set_seed(seed, subject);
@@ -52,6 +59,8 @@ inline bool is_lower_chunk(const Letter *subject, unsigned sid)
 
 inline bool is_lower_or_equal_chunk(const Letter *subject, unsigned sid)
 {
+	if (seed_partition_cache.enabled(sid))
+		return current_range.lower_or_equal(Seed_partition_cache::partition(seed_partition_cache.get(subject, sid)));
 	Packed_seed seed;
 	if (config.algo == Config::double_indexed)
 		shapes[sid].set_seed(seed, subject);
@@ -62,30 +71,89 @@ inline bool is_lower_or_equal_chunk(const Letter *subject, unsigned sid)
 
 inline bool is_high_frequency(const Letter *subject, unsigned sid, bool previous_shape)
 {
+	if (seed_partition_cache.enabled(sid))
+		return Seed_partition_cache::high_frequency(seed_partition_cache.get(subject, sid));
 	if (config.simple_freq)
 		return !SeedComplexity::complex(subject, shapes[sid]);
 	else
 		return frequent_seeds.get(subject, sid);
 }
 
+// Hash of the seed at subject as computed by the reference minimizer sampling (Sequence_set::enum_seeds_minimizer).
+inline uint64_t minimizer_hash(const Letter *subject, const Shape &sh)
+{
+	uint64_t key = 0;
+	for (unsigned i = 0; i < sh.weight_; ++i) {
+		const Letter l = Reduction::reduction(subject[sh.positions_[i]]);
+		if (l == value_traits.mask_char)
+			return std::numeric_limits<uint64_t>::max();
+		key = key * Reduction::reduction.size() + l;
+	}
+	return murmur_hash()(key);
+}
+
+/* Returns true if the seed at subject was indexed for the reference, i.e. is always true unless --minimizer-window
+samples the reference seeds. Otherwise, the seed must be the (leftmost) minimum of one of the windows of w seed
+positions of its sequence that contain it, or of the whole sequence if it has less than w positions. */
+inline bool is_sampled(const Letter *subject, unsigned sid)
+{
+	const size_t w = config.minimizer_window;
+	if (w <= 1)
+		return true;
+	static const uint64_t INVALID = std::numeric_limits<uint64_t>::max();
+	const Shape &sh = shapes[sid];
+	const uint64_t h = minimizer_hash(subject, sh);
+	if (h == INVALID)
+		return false;
+	// Seed positions of the sequence before and after subject, up to w - 1.
+	ptrdiff_t left = 0, right = 0;
+	while (left < (ptrdiff_t)w - 1 && subject[-left - 1] != sequence::DELIMITER)
+		++left;
+	while (right < (ptrdiff_t)w - 1 && subject[right + sh.length_] != sequence::DELIMITER)
+		++right;
+	thread_local vector<uint64_t> hashes;
+	hashes.clear();
+	for (ptrdiff_t i = -left; i <= right; ++i)
+		hashes.push_back(i == 0 ? h : minimizer_hash(subject + i, sh));
+	const uint64_t *p = hashes.data() + left;
+	auto is_minimum = [p, h](ptrdiff_t begin, ptrdiff_t end) {
+		for (ptrdiff_t i = begin; i < 0; ++i)
+			if (p[i] <= h)
+				return false;
+		for (ptrdiff_t i = 1; i < end; ++i)
+			if (p[i] < h)
+				return false;
+		return true;
+	};
+	if (left + right + 1 < (ptrdiff_t)w)
+		return is_minimum(-left, right + 1);
+	for (ptrdiff_t begin = -left; begin <= 0; ++begin)
+		if (begin + (ptrdiff_t)w - 1 <= right && is_minimum(begin, begin + (ptrdiff_t)w))
+			return true;
+	return false;
+}
+
 inline bool shape_collision_right(uint64_t mask, uint64_t shape_mask, const Letter *subject, unsigned sid)
 {
 	if (!match_shape_mask(mask, shape_mask)) return false;
 	return is_lower_chunk(subject, sid)
-		&& !is_high_frequency(subject, sid, false);
+		&& !is_high_frequency(subject, sid, false)
+		&& is_sampled(subject, sid);
 }
 
 inline bool shape_collision_left(uint64_t mask, uint64_t shape_mask, const Letter *subject, unsigned sid, bool chunked)
 {
 	if (!match_shape_mask(mask, shape_mask)) return false;
 	return (!chunked || is_lower_or_equal_chunk(subject, sid))
-		&& !is_high_frequency(subject, sid, false);
+		&& !is_high_frequency(subject, sid, false)
+		&& is_sampled(subject, sid);
 }
 
 inline bool previous_shape_collision(uint64_t mask, uint64_t shape_mask, const Letter *subject, unsigned sid)
 {
 	if (!match_shape_mask(mask, shape_mask)) return false;
-	return !is_high_frequency(subject, sid, true);
+	return !is_high_frequency(subject, sid, true)
+		&& is_sampled(subject, sid);
 }
 
 bool is_primary_hit(const Letter *query,
@@ -19,7 +19,27 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef FINGER_PRINT_H_
 #define FINGER_PRINT_H_
 
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
 #include "../util/simd.h"
+#include "../util/intrin.h"
+#include "../basic/reduction.h"
+
+// 4 bit letter codes for Reduced_finger_print_48, derived from the seed reduction. Letters outside the first 15
+// reduced classes, non-standard and masked letters share code 15.
+struct Finger_print_alphabet
+{
+	static void init(const Reduction &r)
+	{
+		memset(code, 15, sizeof(code));
+		for (size_t i = 0; i < 20; ++i)
+			code[i] = (uint8_t)std::min(r(i), 15u);
+	}
+	static uint8_t code[256];
+};
+
+BEGIN_DISPATCH_TYPES
 
 #ifdef __SSE2__
 
@@ -36,8 +56,17 @@ struct Byte_finger_print_48
 	}
 	unsigned match(const Byte_finger_print_48 &rhs) const
 	{
+#if defined(__AVX512BW__)
+		const __mmask64 mask = 0xffffffffffffllu;
+		return popcount64(_mm512_cmpeq_epi8_mask(_mm512_maskz_loadu_epi8(mask, &r1), _mm512_maskz_loadu_epi8(mask, &rhs.r1)) & mask);
+#elif defined(__AVX2__)
+		const __m256i x = _mm256_loadu_si256((const __m256i*)&r1), y = _mm256_loadu_si256((const __m256i*)&rhs.r1);
+		return popcount64(match_block(r3, rhs.r3) << 32 | (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+#else
 		return popcount64(match_block(r3, rhs.r3) << 32 | match_block(r1, rhs.r1) << 16 | match_block(r2, rhs.r2));
+#endif
 	}
+	// r1, r2, r3 must stay contiguous, the AVX2/AVX-512 paths load them as one block.
 	__m128i r1, r2, r3;
 };
 
@@ -66,6 +95,38 @@ struct Byte_finger_print_48
 
 #endif
 
+// Finger print of the same 48 letters as Byte_finger_print_48, stored as 4 bit reduced letter codes in 24 bytes.
+// The codes are bit-sliced: bit plane k of the 48 positions occupies the low 48 bits of r[k] for k < 3, plane 3 is
+// split into the high 16 bits of r[0..2]. Positions are compared by XOR/OR of the planes and one popcount.
+struct Reduced_finger_print_48
+{
+	Reduced_finger_print_48()
+	{}
+	Reduced_finger_print_48(const Letter *q)
+	{
+		uint64_t p[4] = { 0, 0, 0, 0 };
+		q -= 16;
+		for (unsigned i = 0; i < 48; ++i) {
+			const uint64_t c = Finger_print_alphabet::code[(uint8_t)q[i]];
+			p[0] |= (c & 1) << i;
+			p[1] |= (c >> 1 & 1) << i;
+			p[2] |= (c >> 2 & 1) << i;
+			p[3] |= (c >> 3) << i;
+		}
+		r[0] = p[0] | p[3] << 48;
+		r[1] = p[1] | (p[3] >> 16) << 48;
+		r[2] = p[2] | (p[3] >> 32) << 48;
+	}
+	unsigned match(const Reduced_finger_print_48 &rhs) const
+	{
+		const uint64_t d0 = r[0] ^ rhs.r[0], d1 = r[1] ^ rhs.r[1], d2 = r[2] ^ rhs.r[2];
+		return 48 - popcount64(((d0 | d1 | d2) & 0xffffffffffffllu) | d0 >> 48 | (d1 >> 48) << 16 | (d2 >> 48) << 32);
+	}
+	uint64_t r[3];
+};
+
 typedef Byte_finger_print_48 Finger_print;
 
+END_DISPATCH_TYPES
+
 #endif
\ No newline at end of file
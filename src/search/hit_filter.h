@@ -31,6 +31,45 @@ namespace Search { namespace DISPATCH_ARCH {
 
 #ifdef __SSE2__
 
+/* Gapped verification of stage 2 hits batched over query positions (--stage2-batch). The window pairs of different
+query positions are collected per thread and aligned 16 at a time, one pair per score vector lane, so that the lanes
+are filled even if a query position has few hits. Only query windows that are not clipped by the ends of the query
+sequence are batched: the DP geometry of clipped windows depends on the clipping, and these are verified per query
+position as before. The results are identical to the unbatched filter. */
+struct Window_batch
+{
+
+	enum { CHANNELS = score_traits<uint8_t>::channels };
+
+	void push(Loc q_pos, Loc s_pos, Statistics &stats, Trace_pt_buffer::Iterator &out)
+	{
+		q_pos_[n_] = q_pos;
+		s_pos_[n_] = s_pos;
+		if (++n_ == CHANNELS)
+			flush(stats, out);
+	}
+
+	// Returns true if the window of query position q_pos is not clipped by the sequence ends.
+	static bool full_window(Loc q_pos)
+	{
+		const Letter *q = query_seqs::data_->data(q_pos + config.seed_anchor);
+		for (const Letter *p = q - config.window; p < q + config.window; ++p)
+			if (*p == sequence::DELIMITER)
+				return false;
+		return true;
+	}
+
+	void flush(Statistics &stats, Trace_pt_buffer::Iterator &out);
+
+private:
+
+	Loc q_pos_[CHANNELS], s_pos_[CHANNELS];
+	unsigned n_ = 0;
+	std::vector<score_vector<uint8_t>> scores_;
+	std::vector<Letter> subjects_;
+
+};
+
 struct hit_filter
 {
 
@@ -41,13 +80,16 @@ struct hit_filter
 		seed_offset_ (std::numeric_limits<unsigned>::max()),
 		stats_ (stats),
 		q_pos_ (q_pos),
-		out_ (out)
+		out_ (out),
+		batch_ (config.stage2_batch && Window_batch::full_window(q_pos))
 	{ subjects_.clear(); }
 
 	void push(Loc subject, int score)
 	{
 		if(score >= config.min_hit_raw_score)
 			push_hit(subject);
+		else if (batch_)
+			window_batch.push(q_pos_, subject, stats_, out_);
 		else
 			subjects_.push_back(ref_seqs::data_->fixed_window_infix(subject+ config.seed_anchor));
 	}
@@ -91,8 +133,13 @@ private:
 	Statistics  &stats_;
 	Loc q_pos_;
 	Trace_pt_buffer::Iterator &out_;
+	const bool batch_;
 	static thread_local std::vector<sequence> subjects_;
 
+public:
+
+	static thread_local Window_batch window_batch;
+
 };
 
 #endif
@@ -51,7 +51,9 @@ inline int stage2_ungapped(const Letter *query, const Letter *subject, unsigned
 	return xdrop_ungapped(query, subject, shapes[sid].length_, delta, len);
 }
 
-void search_shape(unsigned sid, unsigned query_block, char *query_buffer, char *ref_buffer);
+struct SeedIndex;
+
+void search_shape(unsigned sid, unsigned query_block, char *query_buffer, char *ref_buffer, const SeedIndex *seed_index);
 bool use_single_indexed(double coverage, size_t query_letters, size_t ref_letters);
 void setup_search_params(pair<size_t, size_t> query_len_bounds, size_t chunk_db_letters);
 void setup_search();
@@ -67,6 +69,8 @@ DECL_DISPATCH(void, stage2, (\
 	Statistics &stats,\
 	Trace_pt_buffer::Iterator &out,\
 	const unsigned sid))
+// Verifies the stage 2 hits that are still held in the calling thread's window batch.
+DECL_DISPATCH(void, stage2_flush, (Statistics &stats, Trace_pt_buffer::Iterator &out))
 
 }
 
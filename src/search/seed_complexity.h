@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <math.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "../basic/value.h"
 #include "../basic/shape.h"
 #include "../basic/reduction.h"
@@ -40,9 +41,26 @@ struct SeedComplexity
 			prob_[i] = log(p[r(i)]);
 		for (size_t i = 20; i < AMINO_ACID_COUNT; ++i)
 			prob_[i] = 1000;
+		for (size_t i = 0; i < AMINO_ACID_COUNT; ++i)
+			iprob_[i] = i < 20 ? (int32_t)lround(prob_[i] * SCALE) : INVALID;
+		threshold_ = (int32_t)lround(-config.freq_treshold * SCALE);
 	}
 
+	// The log-probabilities are summed in fixed point. The rounding error of the sum is at most weight/2, the double
+	// precision sum is only computed if the fixed point sum is that close to the threshold.
 	static bool complex(const char *seq, Shape shape)
+	{
+		int32_t p = 0;
+		for (unsigned i = 0; i < shape.weight_; ++i)
+			p += iprob_[(size_t)seq[shape.positions_[i]]];
+		if (p < threshold_ - (int32_t)shape.weight_)
+			return true;
+		if (p > threshold_ + (int32_t)shape.weight_)
+			return false;
+		return complex_exact(seq, shape);
+	}
+
+	static bool complex_exact(const char *seq, Shape shape)
 	{
 		double p = 0;
 		for (unsigned i = 0; i < shape.weight_; ++i)
@@ -52,7 +70,11 @@ struct SeedComplexity
 
 private:
 
+	enum { SCALE = 1 << 16, INVALID = 1 << 24 };
+
 	static double prob_[AMINO_ACID_COUNT];
+	static int32_t iprob_[AMINO_ACID_COUNT];
+	static int32_t threshold_;
 
 };
 
@@ -19,9 +19,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../data/reference.h"
 #include "../basic/config.h"
 #include "seed_complexity.h"
+#include "finger_print.h"
 #include "search.h"
 
 double SeedComplexity::prob_[AMINO_ACID_COUNT];
+int32_t SeedComplexity::iprob_[AMINO_ACID_COUNT];
+int32_t SeedComplexity::threshold_;
+uint8_t Finger_print_alphabet::code[256];
 const double SINGLE_INDEXED_SEED_SPACE_MAX_COVERAGE = 0.15;
 
 void setup_search_cont()
@@ -86,6 +90,7 @@ void setup_search()
 	}
 
 	SeedComplexity::init(Reduction::reduction);
+	Finger_print_alphabet::init(Reduction::reduction);
 
 	message_stream << "Algorithm: " << (config.algo == Config::double_indexed ? "Double-indexed" : "Query-indexed") << endl;
 	verbose_stream << "Reduction: " << Reduction::reduction << endl;
@@ -17,61 +17,99 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ****/
 
 #include <thread>
+#include <algorithm>
 #include <utility>
 #include <atomic>
+#include <chrono>
+#include <sstream>
 #include "search.h"
 #include "../util/algo/hash_join.h"
 #include "../util/algo/radix_sort.h"
 #include "../data/reference.h"
 #include "../data/seed_array.h"
+#include "../data/seed_index.h"
 #include "../data/queries.h"
 #include "../data/frequent_seeds.h"
+#include "../data/seed_partition_cache.h"
 #include "trace_pt_buffer.h"
+#include "seed_complexity.h"
 #include "../util/data_structures/double_array.h"
 #include "../util/system/system.h"
+#include "../util/parallel/thread_pool.h"
+#include "../util/ptr_vector.h"
 
 using namespace std;
 
 Trace_pt_buffer* Trace_pt_buffer::instance;
 
 void seed_join_worker(
+	size_t i,
+	size_t thread_id,
 	SeedArray *query_seeds,
 	SeedArray *ref_seeds,
-	atomic<unsigned> *seedp,
 	const SeedPartitionRange *seedp_range,
 	DoubleArray<SeedArray::_pos> *query_seed_hits,
-	DoubleArray<SeedArray::_pos> *ref_seeds_hits)
+	DoubleArray<SeedArray::_pos> *ref_seeds_hits,
+	double *join_time)
 {
-	unsigned p;
+	const unsigned p = seedp_range->begin() + (unsigned)i;
 	const unsigned bits = (unsigned)ceil(shapes[0].weight_ * Reduction::reduction.bit_size_exact()) - Const::seedp_bits;
-	while ((p = (*seedp)++) < seedp_range->end()) {
-		std::pair<DoubleArray<SeedArray::_pos>, DoubleArray<SeedArray::_pos>> join = hash_join(
-			Relation<SeedArray::Entry>(query_seeds->begin(p), query_seeds->size(p)),
-			Relation<SeedArray::Entry>(ref_seeds->begin(p), ref_seeds->size(p)),
-			bits);
-		query_seed_hits[p] = join.first;
-		ref_seeds_hits[p] = join.second;
-	}
+	const Relation<SeedArray::Entry> R(query_seeds->begin(p), query_seeds->size(p)), S(ref_seeds->begin(p), ref_seeds->size(p));
+	const auto t = std::chrono::high_resolution_clock::now();
+	std::pair<DoubleArray<SeedArray::_pos>, DoubleArray<SeedArray::_pos>> join = config.join_algo == Config::join_radix_hash
+		? radix_hash_join(R, S, bits)
+		: hash_join(R, S, bits);
+	join_time[i] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t).count();
+	query_seed_hits[p] = join.first;
+	ref_seeds_hits[p] = join.second;
+}
+
+void log_join_time(const SeedPartitionRange &range, SeedArray *query_seeds, SeedArray *ref_seeds, const vector<double> &join_time)
+{
+	std::ostringstream ss;
+	ss << "Seed join time per partition (partition, query seeds, reference seeds, ms):" << endl;
+	for (unsigned p = range.begin(); p < range.end(); ++p)
+		ss << p << '\t' << query_seeds->size(p) << '\t' << ref_seeds->size(p) << '\t' << join_time[p - range.begin()] << endl;
+	log_stream << ss.str();
 }
 
-void search_worker(atomic<unsigned> *seedp, const SeedPartitionRange *seedp_range, unsigned shape, size_t thread_id, DoubleArray<SeedArray::_pos> *query_seed_hits, DoubleArray<SeedArray::_pos> *ref_seed_hits)
+void search_worker(
+	size_t i,
+	size_t thread_id,
+	const SeedPartitionRange *seedp_range,
+	unsigned shape,
+	DoubleArray<SeedArray::_pos> *query_seed_hits,
+	DoubleArray<SeedArray::_pos> *ref_seed_hits,
+	PtrVector<Trace_pt_buffer::Iterator> *out,
+	vector<Statistics> *stats)
 {
-	Trace_pt_buffer::Iterator* out = new Trace_pt_buffer::Iterator(*Trace_pt_buffer::instance, thread_id);
-	Statistics stats;
-	unsigned p;
-	while ((p = (*seedp)++) < seedp_range->end())
-		for (auto it = JoinIterator<SeedArray::_pos>(query_seed_hits[p].begin(), ref_seed_hits[p].begin()); it; ++it)
-			Search::stage1(it.r->begin(), it.r->size(), it.s->begin(), it.s->size(), stats, *out, shape);
-	delete out;
-	statistics += stats;
+	const unsigned p = seedp_range->begin() + (unsigned)i;
+	const Shape &sh = shapes[shape];
+	Statistics &st = (*stats)[thread_id];
+	for (auto it = JoinIterator<SeedArray::_pos>(query_seed_hits[p].begin(), ref_seed_hits[p].begin()); it; ++it) {
+		// Low complexity seeds (--simple-freq) are skipped here rather than removed before the join, so that the
+		// frequent seed filter computes its statistics over all seeds.
+		if (config.simple_freq && !SeedComplexity::complex(query_seqs::get().data(*it.r->begin()), sh)) {
+			st.inc(Statistics::LOW_COMPLEXITY_SEEDS);
+			continue;
+		}
+		Search::stage1(it.r->begin(), it.r->size(), it.s->begin(), it.s->size(), st, (*out)[thread_id], shape);
+	}
+	if (config.stage2_batch)
+		Search::stage2_flush((*stats)[thread_id], (*out)[thread_id]);
 }
 
-void search_shape(unsigned sid, unsigned query_block, char *query_buffer, char *ref_buffer)
+void search_shape(unsigned sid, unsigned query_block, char *query_buffer, char *ref_buffer, const SeedIndex *seed_index)
 {
 	::partition<unsigned> p(Const::seedp, config.lowmem);
 	DoubleArray<SeedArray::_pos> query_seed_hits[Const::seedp], ref_seed_hits[Const::seedp];
 	log_rss();
 
+	if (config.collision_cache) {
+		task_timer timer("Building seed partition cache", true);
+		seed_partition_cache.build(sid);
+	}
+
 	for (unsigned chunk = 0; chunk < p.parts; ++chunk) {
 		message_stream << "Processing query block " << query_block << ", reference block " << current_ref_block << ", shape " << sid << ", index chunk " << chunk << '.' << endl;
 		const SeedPartitionRange range(p.getMin(chunk), p.getMax(chunk));
@@ -79,34 +117,50 @@ void search_shape(unsigned sid, unsigned query_block, char *query_buffer, char *
 
 		task_timer timer("Building reference seed array", true);
 		SeedArray *ref_idx;
-		if (config.algo == Config::query_indexed)
-			ref_idx = new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, query_seeds);
+		if (seed_index)
+			ref_idx = seed_index->seed_array(sid);
+		else if (query_seeds_bloom != 0)
+			ref_idx = new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, query_seeds_bloom, config.minimizer_window);
+		else if (config.algo == Config::query_indexed)
+			ref_idx = new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, query_seeds, config.minimizer_window);
 		else if (query_seeds_hashed != 0)
-			ref_idx = new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, query_seeds_hashed);
+			ref_idx = new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, query_seeds_hashed, config.minimizer_window);
 		else
-			ref_idx = new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, &no_filter);
+			ref_idx = new SeedArray(*ref_seqs::data_, sid, ref_hst.get(sid), range, ref_hst.partition(), ref_buffer, &no_filter, config.minimizer_window);
 
 		timer.go("Building query seed array");
 		SeedArray *query_idx = new SeedArray(*query_seqs::data_, sid, query_hst.get(sid), range, query_hst.partition(), query_buffer, &no_filter);
 
+		if (config.freq_prepass) {
+			timer.go("Building seed filter");
+			frequent_seeds.build_prepass(sid, range, query_idx, ref_idx);
+		}
+
 		timer.go("Computing hash join");
-		atomic<unsigned> seedp(range.begin());
-		vector<thread> threads;
-		for (size_t i = 0; i < config.threads_; ++i)
-			threads.emplace_back(seed_join_worker, query_idx, ref_idx, &seedp, &range, query_seed_hits, ref_seed_hits);
-		for (auto &t : threads)
-			t.join();
+		vector<double> join_time(range.size());
+		Util::Parallel::scheduled_thread_pool_auto(config.threads_, range.size(), seed_join_worker, query_idx, ref_idx, &range, query_seed_hits, ref_seed_hits, join_time.data());
+		if (config.verbosity >= 3)
+			log_join_time(range, query_idx, ref_idx, join_time);
+
+		if (!config.freq_prepass) {
+			timer.go("Building seed filter");
+			frequent_seeds.build(sid, range, query_seed_hits, ref_seed_hits);
+		}
 
-		timer.go("Building seed filter");
-		frequent_seeds.build(sid, range, query_seed_hits, ref_seed_hits);
+		if (config.collision_cache) {
+			timer.go("Updating seed partition cache");
+			seed_partition_cache.update_frequent(sid, range);
+		}
 
 		timer.go("Searching alignments");
-		seedp = range.begin();
-		threads.clear();
+		PtrVector<Trace_pt_buffer::Iterator> out;
 		for (size_t i = 0; i < config.threads_; ++i)
-			threads.emplace_back(search_worker, &seedp, &range, sid, i, query_seed_hits, ref_seed_hits);
-		for (auto &t : threads)
-			t.join();
+			out.push_back(new Trace_pt_buffer::Iterator(*Trace_pt_buffer::instance, i));
+		vector<Statistics> stats(config.threads_);
+		Util::Parallel::scheduled_thread_pool_auto(config.threads_, range.size(), search_worker, &range, sid, query_seed_hits, ref_seed_hits, &out, &stats);
+		out.clear();
+		for (const Statistics &s : stats)
+			statistics += s;
 
 		delete ref_idx;
 		delete query_idx;
@@ -20,7 +20,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "search.h"
 #include "hit_filter.h"
 #include "sse_dist.h"
-#include "seed_complexity.h"
 #include "finger_print.h"
 
 using std::vector;
@@ -30,31 +29,33 @@ namespace DISPATCH_ARCH {
 
 const unsigned tile_size[] = { 1024, 128 };
 
+template<typename _fp>
 struct Range_ref
 {
-	Range_ref(vector<Finger_print>::const_iterator q_begin, vector<Finger_print>::const_iterator s_begin) :
+	Range_ref(typename vector<_fp>::const_iterator q_begin, typename vector<_fp>::const_iterator s_begin) :
 		q_begin(q_begin),
 		s_begin(s_begin)
 	{}
-	const vector<Finger_print>::const_iterator q_begin, s_begin;
+	const typename vector<_fp>::const_iterator q_begin, s_begin;
 };
 
 #define FAST_COMPARE2(q, s, stats, q_ref, s_ref, q_offset, s_offset, hits) if (q.match(s) >= config.min_identities) stats.inc(Statistics::TENTATIVE_MATCHES1)
 #define FAST_COMPARE(q, s, stats, q_ref, s_ref, q_offset, s_offset, hits) if (q.match(s) >= config.min_identities) hits.push_back(Stage1_hit(q_ref, q_offset, s_ref, s_offset))
 
-void query_register_search(vector<Finger_print>::const_iterator q,
-	vector<Finger_print>::const_iterator s,
-	vector<Finger_print>::const_iterator s_end,
-	const Range_ref &ref,
+template<typename _fp>
+void query_register_search(typename vector<_fp>::const_iterator q,
+	typename vector<_fp>::const_iterator s,
+	typename vector<_fp>::const_iterator s_end,
+	const Range_ref<_fp> &ref,
 	vector<Stage1_hit> &hits,
 	Statistics &stats)
 {
 	const unsigned q_ref = unsigned(q - ref.q_begin);
 	unsigned s_ref = unsigned(s - ref.s_begin);
-	Finger_print q1 = *(q++), q2 = *(q++), q3 = *(q++), q4 = *(q++), q5 = *(q++), q6 = *q;
-	const vector<Finger_print>::const_iterator end2 = s_end - (s_end - s) % 4;
+	_fp q1 = *(q++), q2 = *(q++), q3 = *(q++), q4 = *(q++), q5 = *(q++), q6 = *q;
+	const typename vector<_fp>::const_iterator end2 = s_end - (s_end - s) % 4;
 	for (; s < end2; ) {
-		Finger_print s1 = *(s++), s2 = *(s++), s3 = *(s++), s4 = *(s++);
+		_fp s1 = *(s++), s2 = *(s++), s3 = *(s++), s4 = *(s++);
 		stats.inc(Statistics::SEED_HITS, 6 * 4);
 		FAST_COMPARE(q1, s1, stats, q_ref, s_ref, 0, 0, hits);
 		FAST_COMPARE(q2, s1, stats, q_ref, s_ref, 1, 0, hits);
@@ -94,18 +95,19 @@ void query_register_search(vector<Finger_print>::const_iterator q,
 	}
 }
 
-void inner_search(vector<Finger_print>::const_iterator q,
-	vector<Finger_print>::const_iterator q_end,
-	vector<Finger_print>::const_iterator s,
-	vector<Finger_print>::const_iterator s_end,
-	const Range_ref &ref,
+template<typename _fp>
+void inner_search(typename vector<_fp>::const_iterator q,
+	typename vector<_fp>::const_iterator q_end,
+	typename vector<_fp>::const_iterator s,
+	typename vector<_fp>::const_iterator s_end,
+	const Range_ref<_fp> &ref,
 	vector<Stage1_hit> &hits,
 	Statistics &stats)
 {
 	unsigned q_ref = unsigned(q - ref.q_begin);
 	for (; q < q_end; ++q) {
 		unsigned s_ref = unsigned(s - ref.s_begin);
-		for (vector<Finger_print>::const_iterator s2 = s; s2 < s_end; ++s2) {
+		for (typename vector<_fp>::const_iterator s2 = s; s2 < s_end; ++s2) {
 			stats.inc(Statistics::SEED_HITS);
 			FAST_COMPARE((*q), *s2, stats, q_ref, s_ref, 0, 0, hits);
 			++s_ref;
@@ -114,11 +116,12 @@ void inner_search(vector<Finger_print>::const_iterator q,
 	}
 }
 
-void tiled_search(vector<Finger_print>::const_iterator q,
-	vector<Finger_print>::const_iterator q_end,
-	vector<Finger_print>::const_iterator s,
-	vector<Finger_print>::const_iterator s_end,
-	const Range_ref &ref,
+template<typename _fp>
+void tiled_search(typename vector<_fp>::const_iterator q,
+	typename vector<_fp>::const_iterator q_end,
+	typename vector<_fp>::const_iterator s,
+	typename vector<_fp>::const_iterator s_end,
+	const Range_ref<_fp> &ref,
 	unsigned level,
 	std::vector<Stage1_hit> &hits,
 	Statistics &stats)
@@ -127,7 +130,7 @@ void tiled_search(vector<Finger_print>::const_iterator q,
 	case 0:
 	case 1:
 		for (; q < q_end; q += std::min(q_end - q, (ptrdiff_t)tile_size[level]))
-			for (vector<Finger_print>::const_iterator s2 = s; s2 < s_end; s2 += std::min(s_end - s2, (ptrdiff_t)tile_size[level]))
+			for (typename vector<_fp>::const_iterator s2 = s; s2 < s_end; s2 += std::min(s_end - s2, (ptrdiff_t)tile_size[level]))
 				tiled_search(q, q + std::min(q_end - q, (ptrdiff_t)tile_size[level]), s2, s2 + std::min(s_end - s2, (ptrdiff_t)tile_size[level]), ref, level + 1, hits, stats);
 		break;
 	case 2:
@@ -139,30 +142,36 @@ void tiled_search(vector<Finger_print>::const_iterator q,
 	}
 }
 
-void load_fps(const Packed_loc *p, size_t n, vector<Finger_print> &v, const Sequence_set &seqs)
+template<typename _fp>
+void load_fps(const Packed_loc *p, size_t n, vector<_fp> &v, const Sequence_set &seqs)
 {
 	v.clear();
 	v.reserve(n);
 	const Packed_loc *end = p + n;
 	for (; p < end; ++p)
-		v.push_back(Finger_print(seqs.data(*p)));
+		v.push_back(_fp(seqs.data(*p)));
 }
 
+template<typename _fp>
 void stage1(const Packed_loc *q, size_t nq, const Packed_loc *s, size_t ns, Statistics &stats, Trace_pt_buffer::Iterator &out, const unsigned sid)
 {
-	thread_local vector<Finger_print> vq, vs;
+	thread_local vector<_fp> vq, vs;
 	thread_local vector<Stage1_hit> hits;
-	if (config.simple_freq && !SeedComplexity::complex(query_seqs::get().data(q[0]), shapes[sid])) {
-		stats.inc(Statistics::LOW_COMPLEXITY_SEEDS);
-		return;
-	}
 	hits.clear();
 	load_fps(q, nq, vq, *query_seqs::data_);
 	load_fps(s, ns, vs, *ref_seqs::data_);
-	tiled_search(vq.begin(), vq.end(), vs.begin(), vs.end(), Range_ref(vq.begin(), vs.begin()), 0, hits, stats);
+	tiled_search(vq.begin(), vq.end(), vs.begin(), vs.end(), Range_ref<_fp>(vq.begin(), vs.begin()), 0, hits, stats);
 	std::sort(hits.begin(), hits.end());
 	stats.inc(Statistics::TENTATIVE_MATCHES1, hits.size());
 	stage2(q, s, hits, stats, out, sid);
 }
 
+void stage1(const Packed_loc *q, size_t nq, const Packed_loc *s, size_t ns, Statistics &stats, Trace_pt_buffer::Iterator &out, const unsigned sid)
+{
+	if (config.finger_print == Config::finger_print_reduced)
+		stage1<Reduced_finger_print_48>(q, nq, s, ns, stats, out, sid);
+	else
+		stage1<Finger_print>(q, nq, s, ns, stats, out, sid);
+}
+
 }}
\ No newline at end of file
@@ -34,6 +34,40 @@ template<typename _score> thread_local vector<score_vector<_score>> DP_matrix<_s
 template<typename _score> thread_local vector<score_vector<_score>> DP_matrix<_score>::hgap_;
 
 thread_local vector<sequence> hit_filter::subjects_;
+thread_local Window_batch hit_filter::window_batch;
+
+void Window_batch::flush(Statistics &stats, Trace_pt_buffer::Iterator &out)
+{
+	if (n_ == 0)
+		return;
+	const unsigned len = 2 * config.window;
+	const Letter *query[CHANNELS], *subject[CHANNELS];
+	subjects_.resize(len * CHANNELS);
+	for (unsigned k = 0; k < n_; ++k) {
+		query[k] = query_seqs::data_->data(q_pos_[k] + config.seed_anchor - config.window);
+		// Same letters as sequence_stream: masked before the clipping offset and from the first delimiter on.
+		const sequence s = ref_seqs::data_->fixed_window_infix(s_pos_[k] + config.seed_anchor);
+		Letter *dst = &subjects_[k * len];
+		const unsigned clip = (unsigned)std::max(std::min(s.clipping_offset_, (int)len), 0);
+		unsigned j = clip;
+		std::fill(dst, dst + clip, value_traits.mask_char);
+		for (; j < len && s[j] != sequence::DELIMITER; ++j)
+			dst[j] = s[j] & 0x7f;
+		std::fill(dst + j, dst + len, value_traits.mask_char);
+		subject[k] = dst;
+	}
+
+	window_lane_scores(query, subject, n_, len, config.hit_band, scores_);
+	const score_vector<uint8_t> best = smith_waterman_lanes<uint8_t>(len, config.hit_band, scores_.data(), score_matrix.gap_open() + score_matrix.gap_extend(), score_matrix.gap_extend());
+	for (unsigned k = 0; k < n_; ++k)
+		if (best[k] >= config.min_hit_raw_score) {
+			const std::pair<size_t, size_t> l = query_seqs::data_->local_position(q_pos_[k]);
+			out.push(hit((unsigned)l.first, s_pos_[k], (unsigned)l.second));
+			stats.inc(Statistics::GAPPED_HITS);
+			stats.inc(Statistics::TENTATIVE_MATCHES4);
+		}
+	n_ = 0;
+}
 
 void search_query_offset(Loc q,
 	const Packed_loc *s,
@@ -118,6 +152,13 @@ void search_query_offset(Loc q,
 
 #endif
 
+void stage2_flush(Statistics &stats, Trace_pt_buffer::Iterator &out)
+{
+#ifdef __SSE2__
+	hit_filter::window_batch.flush(stats, out);
+#endif
+}
+
 void stage2(const Packed_loc *q,
 	const Packed_loc *s,
 	const vector<Stage1_hit> &hits,
@@ -0,0 +1,131 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Max Planck Society for the Advancement of Science e.V.
+                        Benjamin Buchfink
+                        Eberhard Karls Universitaet Tuebingen
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#include <string.h>
+#include <algorithm>
+#include "trace_pt_buffer.h"
+#include "../util/algo/radix_sort.h"
+
+static inline void write_leb128(uint64_t x, vector<char> &out)
+{
+	while (x >= 0x80) {
+		out.push_back(char(x | 0x80));
+		x >>= 7;
+	}
+	out.push_back(char(x));
+}
+
+static inline uint64_t read_leb128(const uint8_t *&ptr)
+{
+	uint64_t x = *ptr & 0x7f;
+	unsigned shift = 7;
+	while (*ptr++ & 0x80) {
+		x |= uint64_t(*ptr & 0x7f) << shift;
+		shift += 7;
+	}
+	return x;
+}
+
+void HitStream::encode(hit *begin, hit *end, vector<char> &out, vector<hit> &buf)
+{
+	const size_t n = end - begin, header_pos = out.size();
+	buf.resize(n);
+	radix_sort(begin, end, 40, [](const hit &h) { return (uint64_t)h.subject_; }, buf.data());
+	radix_sort(begin, end, 32, [](const hit &h) { return (uint64_t)h.query_; }, buf.data());
+
+	out.resize(header_pos + sizeof(Header));
+	out.reserve(header_pos + sizeof(Header) + n * 8);
+	unsigned query = 0;
+	uint64_t subject = 0;
+	for (const hit *i = begin; i < end; ++i) {
+		write_leb128(i->query_ - query, out);
+		if (i->query_ != query) {
+			query = i->query_;
+			subject = 0;
+		}
+		write_leb128((uint64_t)i->subject_ - subject, out);
+		subject = i->subject_;
+		write_leb128(i->seed_offset_, out);
+	}
+
+	Header header;
+	header.count = (uint32_t)n;
+	header.size = uint32_t(out.size() - header_pos - sizeof(Header));
+	memcpy(out.data() + header_pos, &header, sizeof(Header));
+}
+
+void HitStream::decode(const Header &header, const char *in, hit *out)
+{
+	const uint8_t *ptr = (const uint8_t*)in;
+	unsigned query = 0;
+	uint64_t subject = 0;
+	for (hit *end = out + header.count; out < end; ++out) {
+		const unsigned d = (unsigned)read_leb128(ptr);
+		if (d != 0) {
+			query += d;
+			subject = 0;
+		}
+		subject += read_leb128(ptr);
+		*out = hit(query, subject, (hit::Seed_offset)read_leb128(ptr));
+	}
+	if (ptr != (const uint8_t*)in + header.size)
+		throw std::runtime_error("Format error: Invalid hit block.");
+}
+
+static unsigned bit_width(uint64_t x)
+{
+	unsigned n = 0;
+	for (; x; x >>= 1)
+		++n;
+	return n;
+}
+
+void sort_trace_points(vector<hit> &hits, size_t query_begin, size_t query_end, size_t threads)
+{
+	if (hits.size() < 2)
+		return;
+	const unsigned c = align_mode.query_contexts;
+	vector<uint64_t> max_subjects(threads, 0), max_offsets(threads, 0);
+	Util::Parallel::ThreadPool::get().run(threads, threads, [&](size_t i, size_t) {
+		for (size_t j = hits.size() * i / threads; j < hits.size() * (i + 1) / threads; ++j) {
+			max_subjects[i] = std::max(max_subjects[i], (uint64_t)hits[j].subject_);
+			max_offsets[i] = std::max(max_offsets[i], (uint64_t)hits[j].seed_offset_);
+		}
+	});
+	const uint64_t max_subject = *std::max_element(max_subjects.begin(), max_subjects.end()),
+		max_offset = *std::max_element(max_offsets.begin(), max_offsets.end());
+	const unsigned query_bits = bit_width(query_end - query_begin - 1),
+		subject_bits = bit_width(max_subject),
+		offset_bits = bit_width(max_offset);
+	vector<hit> buf(hits.size());
+	hit *begin = hits.data(), *end = begin + hits.size();
+	auto query = [c, query_begin](const hit &h) { return uint64_t(h.query_ / c - query_begin); };
+
+	if (query_bits + subject_bits + offset_bits <= 64)
+		parallel_radix_sort(begin, end, query_bits + subject_bits + offset_bits, [&](const hit &h) {
+			return (query(h) << (subject_bits + offset_bits)) | ((uint64_t)h.subject_ << offset_bits) | h.seed_offset_;
+		}, buf.data(), threads);
+	else {
+		parallel_radix_sort(begin, end, offset_bits, [](const hit &h) { return (uint64_t)h.seed_offset_; }, buf.data(), threads);
+		parallel_radix_sort(begin, end, query_bits + subject_bits, [&](const hit &h) {
+			return (query(h) << subject_bits) | (uint64_t)h.subject_;
+		}, buf.data(), threads);
+	}
+}
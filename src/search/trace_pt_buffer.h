@@ -99,10 +99,24 @@ struct hit
 
 #pragma pack()
 
-struct Trace_pt_buffer : public Async_buffer<hit>
+// Compact encoding of a block of hits. The hits are sorted by query and subject, queries are delta coded and subjects
+// are delta coded within a query, all as LEB128 varints. The block starts with a Header.
+struct HitStream
 {
-	Trace_pt_buffer(size_t input_size, const string &tmpdir, unsigned query_bins):
-		Async_buffer<hit>(input_size, tmpdir, query_bins)
+	struct Header
+	{
+		uint32_t count, size;
+	};
+	// Sorts [begin, end) and appends the encoded block to out. buf is used as scratch space.
+	static void encode(hit *begin, hit *end, vector<char> &out, vector<hit> &buf);
+	// Decodes the block at in (without the header) into out.
+	static void decode(const Header &header, const char *in, hit *out);
+};
+
+struct Trace_pt_buffer : public Async_buffer<hit, HitStream>
+{
+	Trace_pt_buffer(size_t input_size, const string &tmpdir, unsigned query_bins, size_t mem_budget):
+		Async_buffer<hit, HitStream>(input_size, tmpdir, query_bins, mem_budget)
 	{}
 	static Trace_pt_buffer *instance;
 };
@@ -189,5 +203,8 @@ private:
 #endif
 };
 
+// Sorts hits of the queries [query_begin, query_end) by query, subject and seed offset.
+void sort_trace_points(vector<hit> &hits, size_t query_begin, size_t query_end, size_t threads);
+
 #endif /* TRACE_PT_BUFFER_H_ */
 
@@ -1,5 +1,8 @@
 #include <iostream>
 #include <string>
+#include <map>
+#include <functional>
+#include <stdexcept>
 #include <limits.h>
 #include "../util/io/temp_file.h"
 #include "../util/io/text_input_file.h"
@@ -15,6 +18,37 @@ using std::string;
 
 namespace Test {
 
+/* Each case runs the blastp search of the test dataset with the options set by its function. Cases whose options must
+not change the output name an earlier case they are checked against, the others only report the output hash. */
+struct Test_case
+{
+	const char *name;
+	std::function<void()> set_options;
+	const char *reference;
+};
+
+static const Test_case test_cases[] = {
+	{ "default", [] {}, nullptr },
+	{ "bin-memory 0", [] { config.bin_memory = 0.0; }, "default" },
+	{ "reference blocks", [] { config.chunk_size = 0.00002; }, nullptr },
+	{ "prefetch-size", [] { config.chunk_size = 0.00002; config.prefetch_size = 1.0; }, "reference blocks" },
+	{ "finger-print 1", [] { config.finger_print = Config::finger_print_reduced; }, nullptr },
+	{ "join-algo 1", [] { config.join_algo = Config::join_radix_hash; }, "default" },
+	{ "freq-prepass", [] { config.freq_prepass = true; }, "default" },
+	{ "minimizer-window 4", [] { config.minimizer_window = 4; }, nullptr },
+	{ "bloom-fpr 0.01", [] { config.bloom_fpr = 0.01; }, "default" },
+	{ "stage2-batch", [] { config.stage2_batch = true; }, "default" },
+	{ "collision-cache", [] { config.collision_cache = true; }, "default" },
+	{ "ungapped-batch", [] { config.ungapped_batch = true; }, "default" },
+	{ "simple-freq", [] { config.simple_freq = true; }, "default" },
+	{ "banded swipe", [] { config.ext = Config::banded_swipe; }, nullptr },
+	{ "swipe-layout 1", [] { config.ext = Config::banded_swipe; config.swipe_layout = 1; }, "banded swipe" },
+	{ "swipe-layout 2", [] { config.ext = Config::banded_swipe; config.swipe_layout = 2; }, "banded swipe" },
+	{ "traceback-memory", [] { config.ext = Config::banded_swipe; config.traceback_memory = 1e-6; }, "banded swipe" },
+	{ "swipe-packing 1", [] { config.ext = Config::banded_swipe; config.swipe_packing = 1; }, "banded swipe" },
+	{ "query-cache", [] { config.chunk_size = 0.00002; config.query_cache = true; }, "reference blocks" }
+};
+
 void run() {
 	task_timer timer("Generating test dataset");
 	TempFile proteins;
@@ -30,29 +64,48 @@ void run() {
 	make_db(&db_file, &query_file);
 	DatabaseFile db(*db_file);
 
-	statistics.reset();
-	config.command = Config::blastp;
-	config.algo = 0;
-	config.max_alignments = std::numeric_limits<uint64_t>::max();
-	config.mode_more_sensitive = true;
-	config.lowmem = 1;
-	
-	Workflow::Search::Options opt;
-	opt.db = &db;
-	query_file.rewind();
-	opt.query_file = &query_file;
-	TempFile output_file;
-	opt.consumer = &output_file;
-
-	Workflow::Search::run(opt);
-
-	InputFile out_in(output_file);
-	cout << out_in.hash() << endl;
-
-	out_in.close_and_delete();
+	const size_t n = sizeof(test_cases) / sizeof(test_cases[0]);
+	std::map<string, uint64_t> hashes;
+	size_t failed = 0;
+	for (size_t i = 0; i < n; ++i) {
+		config = Config(2, args, false);
+		statistics.reset();
+		config.command = Config::blastp;
+		config.algo = 0;
+		config.max_alignments = std::numeric_limits<uint64_t>::max();
+		config.mode_more_sensitive = true;
+		config.lowmem = 1;
+		test_cases[i].set_options();
+
+		Workflow::Search::Options opt;
+		opt.db = &db;
+		query_file.rewind();
+		opt.query_file = &query_file;
+		TempFile output_file;
+		opt.consumer = &output_file;
+
+		Workflow::Search::run(opt);
+
+		InputFile out_in(output_file);
+		const uint64_t hash = out_in.hash();
+		hashes[test_cases[i].name] = hash;
+		out_in.close_and_delete();
+
+		cout << test_cases[i].name << '\t' << hash;
+		if (test_cases[i].reference) {
+			const bool passed = hash == hashes.at(test_cases[i].reference);
+			cout << '\t' << (passed ? "passed" : "failed");
+			if (!passed)
+				++failed;
+		}
+		cout << endl;
+	}
+
 	query_file.close_and_delete();
 	db.close();
 	delete db_file;
+	if (failed > 0)
+		throw std::runtime_error(std::to_string(failed) + " test(s) failed.");
 }
 
-}
\ No newline at end of file
+}
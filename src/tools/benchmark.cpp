@@ -27,6 +27,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../dp/swipe/swipe.h"
 #include "../dp/dp.h"
 #include "../dp/score_vector_int8.h"
+#include "../dp/score_vector_int16.h"
+#include "../search/finger_print.h"
+#include "../basic/statistics.h"
+#include "../dp/smith_waterman.h"
+#include "../dp/ungapped.h"
 
 using std::vector;
 using std::chrono::high_resolution_clock;
@@ -39,28 +44,25 @@ namespace Benchmark { namespace DISPATCH_ARCH {
 void scan_cols(const Long_score_profile &qp, sequence s, int i, int j, int j_end)
 {
 #ifdef __SSE4_1__
+	// 64 diagonals per column in vectors of the native width, as read from the profile rows.
 	typedef score_vector<int8_t> Sv;
+	enum { DIAGS = 64, VECTORS = DIAGS / ScoreTraits<Sv>::CHANNELS };
 	const int qlen = (int)qp.length();
 
 	int j2 = std::max(-(i - j + 15), j),
 		i3 = j2 + i - j,
 		j2_end = std::min(qlen - (i - j), j_end);
-	Sv v, max, v1, max1, v2, max2, v3, max3;
+	Sv v[VECTORS], max[VECTORS];
 	for (; j2 < j2_end; ++j2, ++i3) {
 		const int8_t *q = (int8_t*)qp.get(s[j2], i3);
-		v = v + score_vector<int8_t>(q);
-		max.max(v);
-		q += 16;
-		v1 = v1 + score_vector<int8_t>(q);
-		max1.max(v1);
-		q += 16;
-		v2 = v2 + score_vector<int8_t>(q);
-		max2.max(v2);
-		q += 16;
-		v3 = v3 + score_vector<int8_t>(q);
-		max3.max(v3);
+		for (int k = 0; k < VECTORS; ++k) {
+			v[k] = v[k] + Sv(q + k * ScoreTraits<Sv>::CHANNELS);
+			max[k].max(v[k]);
+		}
 	}
-	volatile __m128i x = max.data_, y = max1.data_, z = max2.data_, w = max3.data_;
+	for (int k = 1; k < VECTORS; ++k)
+		max[0].max(max[k]);
+	volatile auto x = max[0].data_;
 #endif
 }
 
@@ -141,6 +143,37 @@ void benchmark_ungapped_sse(const sequence &s1, const sequence &s2)
 }
 #endif
 
+// Measures finger print comparisons on a working set that fits into the L1 cache and while streaming over a large
+// subject array, where the comparison is bound by memory bandwidth.
+template<typename _fp>
+void benchmark_finger_print(const sequence &s1, const sequence &s2, const char *name)
+{
+	static const size_t n = 10000llu, stream_size = 1llu << 20, stream_n = 20;
+	vector<_fp> q, s, stream;
+	for (size_t i = 16; i + 32 <= s1.length(); ++i)
+		q.emplace_back(s1.data() + i);
+	for (size_t i = 16; i + 32 <= s2.length(); ++i)
+		s.emplace_back(s2.data() + i);
+	high_resolution_clock::time_point t1 = high_resolution_clock::now();
+	size_t matches = 0;
+	for (size_t i = 0; i < n; ++i)
+		for (const _fp &x : q)
+			for (size_t j = i % 16; j < s.size(); j += 16)
+				matches += x.match(s[j]);
+	const size_t comparisons = n * q.size() * ((s.size() + 15) / 16);
+	cout << name << " (cached):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / comparisons * 1000 << " ps/Comparison (" << sizeof(_fp) << " bytes)" << endl;
+
+	for (size_t i = 0; i < stream_size; ++i)
+		stream.push_back(s[i % s.size()]);
+	t1 = high_resolution_clock::now();
+	for (size_t i = 0; i < stream_n; ++i)
+		for (const _fp &y : stream)
+			for (size_t j = 0; j < 6; ++j)
+				matches += q[j].match(y);
+	volatile size_t m = matches;
+	cout << name << " (streaming):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (stream_n * stream_size * 6) * 1000 << " ps/Comparison" << endl;
+}
+
 #ifdef __SSE__
 void benchmark_transpose() {
 	static const size_t n = 100000000llu;
@@ -175,43 +208,121 @@ void swipe_cell_update() {
 		for (size_t i = 0; i < n; ++i) {
 			diagonal_cell = cell_update_sv(diagonal_cell, scores, gap_extension, gap_open, horizontal_gap, vertical_gap, best);
 		}
-		volatile __m128i x = diagonal_cell.data_;
+		volatile auto x = diagonal_cell.data_;
 	}
-	cout << "SWIPE cell update (int8_t):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * 16) * 1000 << " ps/Cell" << endl;
+	cout << "SWIPE cell update (int8_t):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * ScoreTraits<score_vector<int8_t>>::CHANNELS) * 1000 << " ps/Cell" << endl;
+#endif
+}
 #endif
+
+#ifdef __SSE2__
+// Stage 2 gapped window filter: one query window against few subject windows per call, as for sparse seed hits, and
+// window pairs of different queries batched over all lanes.
+void hit_filter_windows(const sequence &s1, const sequence &s2) {
+	static const size_t n = 100000llu;
+	const unsigned window = 40, band = 5, len = 2 * window, channels = score_traits<uint8_t>::channels;
+	const int op = score_matrix.gap_open() + score_matrix.gap_extend(), ep = score_matrix.gap_extend();
+	const sequence q(s1.data() + 50, len);
+	vector<sequence> subjects(2, sequence(s2.data() + 50, len));
+	struct Callback {
+		void operator()(int i, const sequence &seq, int score) { ++n; }
+		size_t n = 0;
+	} f;
+	Statistics stats;
+	high_resolution_clock::time_point t1 = high_resolution_clock::now();
+	for (size_t i = 0; i < n; ++i)
+		Search::DISPATCH_ARCH::smith_waterman(q, subjects, band, 0, op, ep, 0, f, uint8_t(), stats);
+	cout << "Hit filter (2 windows/query):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * subjects.size()) << " ns/Window" << endl;
+
+	const Letter *query[16], *subject[16];
+	for (unsigned k = 0; k < channels; ++k) {
+		query[k] = s1.data() + 32 + k;
+		subject[k] = s2.data() + 32 + k;
+	}
+	vector<score_vector<uint8_t>> scores;
+	score_vector<uint8_t> best;
+	t1 = high_resolution_clock::now();
+	for (size_t i = 0; i < n / 8; ++i) {
+		Search::DISPATCH_ARCH::window_lane_scores(query, subject, channels, len, band, scores);
+		best.max(Search::DISPATCH_ARCH::smith_waterman_lanes<uint8_t>(len, band, scores.data(), op, ep));
+	}
+	uint8_t best_scores[16];
+	best.store(best_scores);
+	cout << "Hit filter (batched):\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n / 8 * channels) << " ns/Window (score=" << (int)best_scores[0] << ")" << endl;
 }
 #endif
 
 #ifdef __SSE4_1__
 void swipe(const sequence &s1, const sequence &s2) {
-	sequence target[16];
-	std::fill(target, target + 16, s2);
+	const size_t channels = ScoreTraits<score_vector<int8_t>>::CHANNELS;
+	sequence target[channels];
+	std::fill(target, target + channels, s2);
 	static const size_t n = 10000llu;
 	high_resolution_clock::time_point t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		volatile list<Hsp> v = DP::Swipe::swipe(s1, target, target + 16, 100);
+		volatile list<Hsp> v = DP::Swipe::swipe(s1, target, target + channels, 100);
 	}
-	cout << "SWIPE (int8_t):\t\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * s1.length() * s2.length() * 16) * 1000 << " ps/Cell" << endl;
+	cout << "SWIPE (int8_t):\t\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * s1.length() * s2.length() * channels) * 1000 << " ps/Cell" << endl;
 }
 #endif
 
 void banded_swipe(const sequence &s1, const sequence &s2) {
+#ifdef __SSE2__
+	const size_t channels = ScoreTraits<score_vector<int16_t>>::CHANNELS;
+#else
+	const size_t channels = 8;
+#endif
 	vector<DpTarget> target;
-	for (size_t i = 0; i < 8; ++i)
+	for (size_t i = 0; i < channels; ++i)
 		target.emplace_back(s2, -32, 32);
 	static const size_t n = 10000llu;
 	Bias_correction cbs(s1);
+	DpStat stat;
 	high_resolution_clock::time_point t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		volatile auto out = DP::BandedSwipe::swipe(s1, target.begin(), target.end(), Frame(0), &cbs, 0, 0);
+		volatile auto out = DP::BandedSwipe::swipe(s1, target.begin(), target.end(), Frame(0), &cbs, stat, 0, 0);
+	}
+	cout << "Banded SWIPE (CBS):\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * s1.length() * 65 * channels) * 1000 << " ps/Cell" << endl;
+
+	t1 = high_resolution_clock::now();
+	for (size_t i = 0; i < n; ++i) {
+		volatile auto out = DP::BandedSwipe::swipe(s1, target.begin(), target.end(), Frame(0), nullptr, stat, 0, 0);
+	}
+	cout << "Banded SWIPE:\t\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * s1.length() * 65 * channels) * 1000 << " ps/Cell" << endl;
+
+	target.erase(target.begin() + 1, target.end());
+	config.swipe_layout = Config::swipe_layout_inter;
+	t1 = high_resolution_clock::now();
+	for (size_t i = 0; i < n; ++i) {
+		volatile auto out = DP::BandedSwipe::swipe(s1, target.begin(), target.end(), Frame(0), &cbs, stat, DP::TRACEBACK, 0);
 	}
-	cout << "Banded SWIPE (CBS):\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * s1.length() * 65 * 8) * 1000 << " ps/Cell" << endl;
+	cout << "Banded SWIPE (1 target, inter):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * s1.length() * 65) * 1000 << " ps/Cell" << endl;
 
+	config.swipe_layout = Config::swipe_layout_intra;
 	t1 = high_resolution_clock::now();
 	for (size_t i = 0; i < n; ++i) {
-		volatile auto out = DP::BandedSwipe::swipe(s1, target.begin(), target.end(), Frame(0), nullptr, 0, 0);
+		volatile auto out = DP::BandedSwipe::swipe(s1, target.begin(), target.end(), Frame(0), &cbs, stat, DP::TRACEBACK, 0);
 	}
-	cout << "Banded SWIPE:\t\t\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * s1.length() * 65 * 8) * 1000 << " ps/Cell" << endl;
+	cout << "Banded SWIPE (1 target, intra):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * s1.length() * 65) * 1000 << " ps/Cell" << endl;
+	config.swipe_layout = Config::swipe_layout_auto;
+}
+
+// Ungapped extension of 16 seed hits of a target, one at a time and in lanes.
+void ungapped_batch(const sequence &s1, const sequence &s2, const char *desc) {
+	static const size_t n = 100000llu, hits = 16;
+	int qa[hits], sa[hits];
+	for (size_t i = 0; i < hits; ++i)
+		qa[i] = sa[i] = (int)(i * 16 + 8);
+	Diagonal_segment d[hits];
+	high_resolution_clock::time_point t1 = high_resolution_clock::now();
+	for (size_t i = 0; i < n; ++i)
+		for (size_t j = 0; j < hits; ++j)
+			d[j] = xdrop_ungapped(s1, s2, qa[j], sa[j]);
+	cout << desc << " (scalar):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * hits) << " ns/Hit" << endl;
+	t1 = high_resolution_clock::now();
+	for (size_t i = 0; i < n; ++i)
+		::DISPATCH_ARCH::xdrop_ungapped_batch(s1, s2, qa, sa, hits, d);
+	cout << desc << " (batched):\t" << (double)duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - t1).count() / (n * hits) << " ns/Hit" << endl;
 }
 
 #ifdef __SSE4_1__
@@ -235,18 +346,26 @@ void benchmark() {
 	s4 = sequence::from_string("lvhvasvekgrsyedfqkvynaialklreddeydnyigygpvlvrlawhisgtwdkhdntggsyggtyrfkkefndpsnaglqngfkflepihkefpwissgdlfslggvtavqemqgpkipwrcgrvdtpedttpdngrlpdadkdagyvrtffqrlnmndrevvalmgahalgkthlknsgyegpggaannvftnefylnllnedwklekndanneqwdsksgymmlptdysliqdpkylsivkeyandqdkffkdfskafekllengitfpkdapspfifktleeqgl"); // d2euta_
 
 	benchmark_ungapped(s1, s2);
+	ungapped_batch(s1, s2, "Ungapped extension");
+	ungapped_batch(s1, s1, "Ungapped extension (identical)");
 #ifdef __SSSE3__
 	benchmark_ungapped_sse(s1, s2);
 #endif
 #ifdef __SSE__
 	benchmark_transpose();
 #endif
+	Finger_print_alphabet::init(Reduction::reduction);
+	benchmark_finger_print<Finger_print>(s1, s2, "Finger print (letters)");
+	benchmark_finger_print<Reduced_finger_print_48>(s1, s2, "Finger print (reduced)");
 #ifdef __SSE2__
 	banded_swipe(s1, s2);
 	swipe_cell_update();
+	hit_filter_windows(s1, s2);
 #endif
 #ifdef __SSE4_1__
 	swipe(s3, s4);
+#endif
+#ifdef __SSE4_1__
 	diag_scores(s1, s2);
 #endif
 }
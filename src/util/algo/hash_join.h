@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <cstdlib>
 #include <utility>
 #include <algorithm>
+#include <vector>
 #include "../../basic/config.h"
 #include "../util.h"
 #include "radix_cluster.h"
@@ -44,7 +45,8 @@ struct RelPtr
 	unsigned r, s;
 };
 
-template<typename _t>
+// If _prefetch is set, S is probed in batches: the table slots of a batch are prefetched before they are accessed.
+template<typename _t, bool _prefetch = false>
 void hash_table_join(
 	const Relation<_t> &R,
 	const Relation<_t> &S,
@@ -52,6 +54,7 @@ void hash_table_join(
 	DoubleArray<typename _t::Value> &dst_r,
 	DoubleArray<typename _t::Value> &dst_s)
 {
+	static const ptrdiff_t PREFETCH_BATCH = 16;
 	typedef HashTable<unsigned, RelPtr, ExtractBits> Table;
 	
 	uint32_t N = (uint32_t)next_power_of_2(R.n * config.join_ht_factor);
@@ -65,14 +68,25 @@ void hash_table_join(
 	}
 
 	_t *hit_s = S.data;
-	for (_t *i = S.data; i < S.end(); ++i) {
+	auto probe = [&](const _t *i) {
 		if ((p = table.find_entry(i->key))) {
 			++p->s;
 			hit_s->value = i->value;
 			hit_s->key = unsigned(p - table.data());
 			++hit_s;
 		}
-	}
+	};
+	if (_prefetch)
+		for (_t *batch = S.data; batch < S.end(); batch += PREFETCH_BATCH) {
+			const _t *batch_end = std::min<const _t*>(batch + PREFETCH_BATCH, S.end());
+			for (const _t *i = batch; i < batch_end; ++i)
+				table.prefetch(i->key);
+			for (const _t *i = batch; i < batch_end; ++i)
+				probe(i);
+		}
+	else
+		for (const _t *i = S.data; i < S.end(); ++i)
+			probe(i);
 
 	typename DoubleArray<typename _t::Value>::Iterator it_r = dst_r.begin(), it_s = dst_s.begin();
 	
@@ -165,6 +179,26 @@ void table_join(
 	free(table);
 }
 
+template<typename _t, bool _prefetch>
+void join_partition(
+	const Relation<_t> &R,
+	const Relation<_t> &S,
+	_t *dst_r,
+	_t *dst_s,
+	DoubleArray<typename _t::Value> &out_r,
+	DoubleArray<typename _t::Value> &out_s,
+	unsigned total_bits,
+	unsigned shift)
+{
+	DoubleArray<typename _t::Value> tmp_r((void*)dst_r), tmp_s((void*)dst_s);
+	if (next_power_of_2(R.n * config.join_ht_factor) < 1llu << (total_bits - shift))
+		hash_table_join<_t, _prefetch>(R, S, shift, tmp_r, tmp_s);
+	else
+		table_join(R, S, total_bits, shift, tmp_r, tmp_s);
+	out_r.append(tmp_r);
+	out_s.append(tmp_s);
+}
+
 template<typename _t>
 void hash_join(
 	Relation<_t> R,
@@ -179,15 +213,8 @@ void hash_join(
 	if (R.n == 0 || S.n == 0)
 		return;
 	const unsigned key_bits = total_bits - shift;
-	if (R.n < config.join_split_size || key_bits < config.join_split_key_len) {
-		DoubleArray<typename _t::Value> tmp_r((void*)dst_r), tmp_s((void*)dst_s);
-		if (next_power_of_2(R.n * config.join_ht_factor) < 1llu << key_bits)
-			hash_table_join(R, S, shift, tmp_r, tmp_s);
-		else
-			table_join(R, S, total_bits, shift, tmp_r, tmp_s);
-		out_r.append(tmp_r);
-		out_s.append(tmp_s);
-	}
+	if (R.n < config.join_split_size || key_bits < config.join_split_key_len)
+		join_partition<_t, false>(R, S, dst_r, dst_s, out_r, out_s, total_bits, shift);
 	else {
 		const unsigned clusters = 1 << config.radix_bits;
 		unsigned *hstR = new unsigned[clusters], *hstS = new unsigned[clusters];
@@ -214,4 +241,39 @@ std::pair<DoubleArray<typename _t::Value>, DoubleArray<typename _t::Value>> hash
 	return { out_r, out_s };
 }
 
+// Two-level radix-partitioned join. R and S are clustered in one pass on as many low key bits as needed for the hash
+// table of each cluster to fit into config.join_cache_size bytes, then the clusters are joined with prefetched probes.
+template<typename _t>
+std::pair<DoubleArray<typename _t::Value>, DoubleArray<typename _t::Value>> radix_hash_join(Relation<_t> R, Relation<_t> S, unsigned total_bits = 32) {
+	typedef typename HashTable<unsigned, RelPtr, ExtractBits>::Entry Entry;
+	static const unsigned MAX_CLUSTER_BITS = 12;
+	DoubleArray<typename _t::Value> out_r((void*)R.data), out_s((void*)S.data);
+	if (R.n == 0 || S.n == 0)
+		return { out_r, out_s };
+
+	const size_t table_size = next_power_of_2(R.n * config.join_ht_factor) * sizeof(Entry);
+	unsigned bits = 0;
+	while ((table_size >> bits) > config.join_cache_size && bits < MAX_CLUSTER_BITS && bits + 1 < total_bits)
+		++bits;
+
+	_t *buf_r = (_t*)malloc(sizeof(_t) * R.n), *buf_s = (_t*)malloc(sizeof(_t) * S.n);
+	if (bits == 0)
+		join_partition<_t, true>(R, S, buf_r, buf_s, out_r, out_s, total_bits, 0);
+	else {
+		const unsigned clusters = 1 << bits;
+		std::vector<unsigned> hst_r(clusters), hst_s(clusters);
+		radix_cluster(R, 0, buf_r, hst_r.data(), bits);
+		radix_cluster(S, 0, buf_s, hst_s.data(), bits);
+		for (unsigned i = 0; i < clusters; ++i) {
+			const unsigned r_begin = i ? hst_r[i - 1] : 0, s_begin = i ? hst_s[i - 1] : 0;
+			const Relation<_t> r(buf_r + r_begin, hst_r[i] - r_begin), s(buf_s + s_begin, hst_s[i] - s_begin);
+			if (r.n > 0 && s.n > 0)
+				join_partition<_t, true>(r, s, R.data + r_begin, S.data + s_begin, out_r, out_s, total_bits, bits);
+		}
+	}
+	free(buf_r);
+	free(buf_s);
+	return { out_r, out_s };
+}
+
 #endif
\ No newline at end of file
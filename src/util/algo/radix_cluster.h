@@ -55,10 +55,10 @@ struct ExtractBits
 };
 
 template<typename _t>
-void radix_cluster(const Relation<_t> &in, unsigned shift, _t *out, unsigned *hst)
+void radix_cluster(const Relation<_t> &in, unsigned shift, _t *out, unsigned *hst, unsigned bits)
 {
 	static const size_t BUF_SIZE = 8;
-	const unsigned clusters = 1 << config.radix_bits;
+	const unsigned clusters = 1 << bits;
 	ExtractBits radix(clusters, shift);
 
 	memset(hst, 0, clusters*sizeof(unsigned));
@@ -96,4 +96,10 @@ void radix_cluster(const Relation<_t> &in, unsigned shift, _t *out, unsigned *hs
 	}
 }
 
+template<typename _t>
+void radix_cluster(const Relation<_t> &in, unsigned shift, _t *out, unsigned *hst)
+{
+	radix_cluster(in, shift, out, hst, config.radix_bits);
+}
+
 #endif
\ No newline at end of file
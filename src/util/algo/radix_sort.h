@@ -20,27 +20,104 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RADIX_SORT2_H_
 
 #include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <array>
 #include "radix_cluster.h"
+#include "../parallel/thread_pool.h"
 
-/*template<typename _t>
-void radix_sort(Relation<_t> &R, unsigned total_bits, _t *buf = 0)
+// Stable LSD radix sort of [begin, end) by the lowest key_bits bits of key(x), using 8 bit digits.
+// Digits that are identical for all elements are skipped. buf must provide space for end - begin elements.
+template<typename _t, typename _key>
+void radix_sort(_t *begin, _t *end, unsigned key_bits, _key key, _t *buf)
 {
-	bool dealloc = false;
-	if (!buf) {
-		//buf = new _t[R.n];
-		//buf = (_t*)new char[sizeof(_t)*R.n];
-		buf = (_t*)MemoryPool::global().alloc(sizeof(_t)*R.n);
-		dealloc = true;
+	static const unsigned DIGIT_BITS = 8, DIGITS = 1 << DIGIT_BITS, MAX_PASSES = 64 / DIGIT_BITS;
+	const size_t n = end - begin;
+	const unsigned passes = (key_bits + DIGIT_BITS - 1) / DIGIT_BITS;
+	if (n < 2 || passes == 0)
+		return;
+	size_t hst[MAX_PASSES][DIGITS];
+	memset(hst, 0, sizeof(hst));
+	for (const _t *i = begin; i < end; ++i) {
+		uint64_t k = key(*i);
+		for (unsigned p = 0; p < passes; ++p) {
+			++hst[p][k & (DIGITS - 1)];
+			k >>= DIGIT_BITS;
+		}
 	}
-	unsigned *hst = new unsigned[1 << config.radix_bits];
-	_t *in = R.data, *out = buf;
-	for (int bits = (int)total_bits; bits > 0; bits -= config.radix_bits) {
-		radix_cluster(Relation<_t>(in, R.n), total_bits - bits, out, hst);
+
+	_t *in = begin, *out = buf;
+	for (unsigned p = 0; p < passes; ++p) {
+		size_t *h = hst[p];
+		if (h[key(*in) >> (p * DIGIT_BITS) & (DIGITS - 1)] == n)
+			continue;
+		size_t sum = 0;
+		for (unsigned i = 0; i < DIGITS; ++i) {
+			const size_t c = h[i];
+			h[i] = sum;
+			sum += c;
+		}
+		const unsigned shift = p * DIGIT_BITS;
+		for (const _t *i = in; i < in + n; ++i)
+			out[h[key(*i) >> shift & (DIGITS - 1)]++] = *i;
+		std::swap(in, out);
+	}
+	if (in != begin)
+		std::copy(in, in + n, begin);
+}
+
+// Parallel version of radix_sort. The input is split into one slice per thread; each pass computes per-slice
+// histograms and scatters the slices concurrently to their precomputed output offsets, which keeps the sort stable.
+template<typename _t, typename _key>
+void parallel_radix_sort(_t *begin, _t *end, unsigned key_bits, _key key, _t *buf, size_t threads)
+{
+	static const unsigned DIGIT_BITS = 8, DIGITS = 1 << DIGIT_BITS;
+	static const size_t MIN_SLICE_SIZE = 65536;
+	const size_t n = end - begin;
+	const unsigned passes = (key_bits + DIGIT_BITS - 1) / DIGIT_BITS;
+	const size_t slices = std::max(std::min(threads, n / MIN_SLICE_SIZE), (size_t)1);
+	if (slices == 1) {
+		radix_sort(begin, end, key_bits, key, buf);
+		return;
+	}
+	Util::Parallel::ThreadPool &pool = Util::Parallel::ThreadPool::get();
+	std::vector<std::array<size_t, DIGITS>> hst(slices);
+	auto slice_begin = [n, slices](size_t i) { return n * i / slices; };
+
+	_t *in = begin, *out = buf;
+	for (unsigned p = 0; p < passes; ++p) {
+		const unsigned shift = p * DIGIT_BITS;
+		pool.run(threads, slices, [&](size_t i, size_t) {
+			std::array<size_t, DIGITS> &h = hst[i];
+			h.fill(0);
+			for (const _t *j = in + slice_begin(i); j < in + slice_begin(i + 1); ++j)
+				++h[key(*j) >> shift & (DIGITS - 1)];
+		});
+		const unsigned d0 = key(*in) >> shift & (DIGITS - 1);
+		size_t c0 = 0;
+		for (size_t i = 0; i < slices; ++i)
+			c0 += hst[i][d0];
+		if (c0 == n)
+			continue;
+		size_t sum = 0;
+		for (unsigned d = 0; d < DIGITS; ++d)
+			for (size_t i = 0; i < slices; ++i) {
+				const size_t c = hst[i][d];
+				hst[i][d] = sum;
+				sum += c;
+			}
+		pool.run(threads, slices, [&](size_t i, size_t) {
+			std::array<size_t, DIGITS> &h = hst[i];
+			for (const _t *j = in + slice_begin(i); j < in + slice_begin(i + 1); ++j)
+				out[h[key(*j) >> shift & (DIGITS - 1)]++] = *j;
+		});
 		std::swap(in, out);
 	}
-	//if(dealloc) delete[] buf;
-	if (dealloc) MemoryPool::global().free(buf);
-	delete[] hst;
-}*/
+	if (in != begin)
+		pool.run(threads, slices, [&](size_t i, size_t) {
+			std::copy(in + slice_begin(i), in + slice_begin(i + 1), begin + slice_begin(i));
+		});
+}
 
-#endif
\ No newline at end of file
+#endif
@@ -21,6 +21,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <vector>
 #include <exception>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
 #include <assert.h>
 #include "../basic/config.h"
 #include "io/temp_file.h"
@@ -33,21 +37,26 @@ using std::vector;
 using std::string;
 using std::endl;
 
-template<typename _t>
+// Buffers records in a fixed number of bins. Records are encoded in blocks using _codec and kept in memory as long as
+// the total size does not exceed the memory budget; further blocks are spilled to one temporary file per bin.
+template<typename _t, typename _codec>
 struct Async_buffer
 {
 
 	typedef vector<_t> Vector;
+	typedef vector<char> Block;
+	typedef typename _codec::Header Header;
 
-	Async_buffer(size_t input_count, const string &tmpdir, unsigned bins) :
+	Async_buffer(size_t input_count, const string &tmpdir, unsigned bins, size_t mem_budget = 0) :
 		bins_(bins),
 		bin_size_((input_count + bins_ - 1) / bins_),
 		input_count_(input_count),
-		bins_processed_(0)
+		bins_processed_(0),
+		mem_budget_(mem_budget),
+		mem_used_(0),
+		bin_(bins)
 	{
-		log_stream << "Async_buffer() " << input_count << ',' << bin_size_ << endl;
-		for (unsigned i = 0; i < bins; ++i)
-			tmp_file_.push_back(new AsyncFile());
+		log_stream << "Async_buffer() " << input_count << ',' << bin_size_ << ',' << mem_budget << endl;
 	}
 
 	size_t begin(size_t bin) const
@@ -64,10 +73,11 @@ struct Async_buffer
 	{
 		Iterator(Async_buffer &parent, size_t thread_num) :
 			buffer_(parent.bins()),
+			blocks_(parent.bins()),
 			parent_(parent)
 		{
-			for (unsigned i = 0; i < parent.bins_; ++i)
-				out_.push_back(&parent.tmp_file_[i]);
+			for (Vector &v : buffer_)
+				v.reserve(buffer_size);
 		}
 		void push(const _t &x)
 		{
@@ -75,22 +85,34 @@ struct Async_buffer
 			assert(bin < parent_.bins());
 			buffer_[bin].push_back(x);
 			if (buffer_[bin].size() == buffer_size)
-				flush(bin);
+				flush(bin, true);
 		}
-		void flush(unsigned bin)
+		void flush(unsigned bin, bool reserve)
 		{
-			out_[bin]->write(buffer_[bin].data(), buffer_[bin].size());
+			if (buffer_[bin].empty())
+				return;
+			Block block;
+			_codec::encode(buffer_[bin].data(), buffer_[bin].data() + buffer_[bin].size(), block, sort_buf_);
+			if (parent_.reserve_mem(block.size()))
+				blocks_[bin].push_back(std::move(block));
+			else
+				parent_.spill(bin, block);
 			buffer_[bin].clear();
+			if (!reserve)
+				Vector().swap(buffer_[bin]);
 		}
 		~Iterator()
 		{
-			for (unsigned bin = 0; bin < parent_.bins_; ++bin)
-				flush(bin);
+			for (unsigned bin = 0; bin < parent_.bins_; ++bin) {
+				flush(bin, false);
+				parent_.add_blocks(bin, blocks_[bin]);
+			}
 		}
 	private:
 		enum { buffer_size = 65536 };
-		vector<vector<_t> > buffer_;
-		vector<AsyncFile*> out_;
+		vector<Vector> buffer_;
+		Vector sort_buf_;
+		vector<vector<Block>> blocks_;
 		Async_buffer &parent_;
 	};
 
@@ -101,22 +123,21 @@ struct Async_buffer
 			total_size = 0;
 		if (bins_processed_ == bins_) {
 			input_range = std::make_pair(0, 0);
-			return total_size*sizeof(_t);
+			return total_size;
 		}
-		size_t size = tmp_file_[bins_processed_].tell()/sizeof(_t), end = bins_processed_ + 1, current_size;
-		while (end < bins_ && (size + (current_size = tmp_file_[end].tell() / sizeof(_t))) * sizeof(_t) < max_size) {
+		size_t size = bin_count(bins_processed_), end = bins_processed_ + 1, current_size;
+		while (end < bins_ && (size + (current_size = bin_count(end))) * sizeof(_t) < max_size) {
 			size += current_size;
 			++end;
 		}
 		log_stream << "Async_buffer.load() " << size << "(" << (double)size*sizeof(_t) / (1 << 30) << " GB)" << endl;
-		total_size += size;
 		data.resize(size);
 		_t* ptr = data.data();
 		input_range.first = begin(bins_processed_);
 		for (; bins_processed_ < end; ++bins_processed_)
-			load_bin(ptr, bins_processed_);
+			total_size += load_bin(ptr, bins_processed_);
 		input_range.second = this->end(bins_processed_ - 1);
-		return total_size*sizeof(_t);
+		return total_size;
 	}
 
 	unsigned bins() const
@@ -126,21 +147,101 @@ struct Async_buffer
 
 private:
 
-	void load_bin(_t*& ptr, size_t bin)
+	struct Bin
 	{
-		const size_t s = tmp_file_[bin].tell() / sizeof(_t);
-		InputFile f(tmp_file_[bin]);
-		const size_t n = f.read(ptr, s);
-		ptr += s;
+		Bin():
+			mem_count(0),
+			file_count(0),
+			file_size(0)
+		{}
+		std::mutex mtx;
+		vector<Block> blocks;
+		size_t mem_count, file_count, file_size;
+		std::unique_ptr<AsyncFile> file;
+	};
+
+	bool reserve_mem(size_t n)
+	{
+		size_t used = mem_used_.load(std::memory_order_relaxed);
+		do {
+			if (used + n > mem_budget_)
+				return false;
+		} while (!mem_used_.compare_exchange_weak(used, used + n, std::memory_order_relaxed));
+		return true;
+	}
+
+	static const Header& header(const Block &block)
+	{
+		return *reinterpret_cast<const Header*>(block.data());
+	}
+
+	void spill(size_t bin, const Block &block)
+	{
+		std::lock_guard<std::mutex> lock(bin_[bin].mtx);
+		if (!bin_[bin].file)
+			bin_[bin].file.reset(new AsyncFile());
+		bin_[bin].file->write(block.data(), block.size());
+		bin_[bin].file_count += header(block).count;
+		bin_[bin].file_size += block.size();
+	}
+
+	void add_blocks(size_t bin, vector<Block> &blocks)
+	{
+		std::lock_guard<std::mutex> lock(bin_[bin].mtx);
+		for (Block &b : blocks) {
+			bin_[bin].mem_count += header(b).count;
+			bin_[bin].blocks.push_back(std::move(b));
+		}
+		blocks.clear();
+	}
+
+	size_t bin_count(size_t bin) const
+	{
+		return bin_[bin].mem_count + bin_[bin].file_count;
+	}
+
+	// Decodes the records of a bin to ptr and returns the encoded size.
+	size_t load_bin(_t*& ptr, size_t bin)
+	{
+		Bin &b = bin_[bin];
+		size_t mem_size = 0;
+		for (Block &block : b.blocks) {
+			const Header &h = header(block);
+			_codec::decode(h, block.data() + sizeof(Header), ptr);
+			ptr += h.count;
+			mem_size += block.size();
+			Block().swap(block);
+		}
+		b.blocks.clear();
+		mem_used_ -= mem_size;
+		b.mem_count = 0;
+		if (!b.file)
+			return mem_size;
+		InputFile f(*b.file);
+		Block buf;
+		size_t n = 0;
+		Header h;
+		while (n < b.file_count) {
+			if (f.read(&h, 1) != 1)
+				throw std::runtime_error("Error reading temporary file: " + f.file_name);
+			buf.resize(h.size);
+			if (f.read(buf.data(), h.size) != h.size)
+				throw std::runtime_error("Error reading temporary file: " + f.file_name);
+			_codec::decode(h, buf.data(), ptr);
+			ptr += h.count;
+			n += h.count;
+		}
 		f.close_and_delete();
-		if (n != s)
-			throw std::runtime_error("Error reading temporary file: " + f.file_name);
+		b.file.reset();
+		return mem_size + b.file_size;
 	}
 
 	const unsigned bins_;
 	const size_t bin_size_, input_count_;
 	size_t bins_processed_;
-	PtrVector<AsyncFile> tmp_file_;
+	const size_t mem_budget_;
+	std::atomic<size_t> mem_used_;
+	vector<Bin> bin_;
 
 };
 
@@ -0,0 +1,101 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2019 Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#ifndef BLOOM_FILTER_H_
+#define BLOOM_FILTER_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include "mem_buffer.h"
+
+// Cache-line blocked Bloom filter: all k bits of a key are set in one 512 bit block, so a lookup touches a single
+// cache line. The caller supplies well mixed 64 bit hash values; the upper half selects the block, the lower half
+// the bits within the block.
+struct BlockedBloomFilter
+{
+
+	// Sized for n keys at a false positive rate of about fpr.
+	BlockedBloomFilter(size_t n, double fpr)
+	{
+		const double bits_per_key = -std::log(fpr) / (std::log(2.0) * std::log(2.0));
+		const size_t blocks = std::max((size_t)std::ceil(n * bits_per_key / BLOCK_BITS), (size_t)1);
+		k_ = std::min(std::max((unsigned)std::lround(-std::log2(fpr)), 1u), 16u);
+		data_.resize(blocks);
+		std::fill((char*)data_.begin(), (char*)data_.end(), 0);
+	}
+
+	// Returns true if the key was not contained before.
+	bool insert(uint64_t hash)
+	{
+		Block &b = data_[block_index(hash)];
+		uint32_t x = (uint32_t)hash;
+		const uint32_t step = (uint32_t)(hash * 0x9E3779B97F4A7C15llu >> 32) | 1;
+		uint64_t missing = 0;
+		for (unsigned i = 0; i < k_; ++i, x += step) {
+			const unsigned bit = x >> (32 - BLOCK_SHIFT);
+			const uint64_t m = 1llu << (bit & 63);
+			missing |= ~b.w[bit >> 6] & m;
+			b.w[bit >> 6] |= m;
+		}
+		return missing != 0;
+	}
+
+	bool contains(uint64_t hash) const
+	{
+		const Block &b = data_[block_index(hash)];
+		uint32_t x = (uint32_t)hash;
+		const uint32_t step = (uint32_t)(hash * 0x9E3779B97F4A7C15llu >> 32) | 1;
+		for (unsigned i = 0; i < k_; ++i, x += step) {
+			const unsigned bit = x >> (32 - BLOCK_SHIFT);
+			if ((b.w[bit >> 6] & (1llu << (bit & 63))) == 0)
+				return false;
+		}
+		return true;
+	}
+
+	size_t size_bytes() const
+	{
+		return data_.size() * sizeof(Block);
+	}
+
+	unsigned hash_functions() const
+	{
+		return k_;
+	}
+
+private:
+
+	enum { BLOCK_SHIFT = 9, BLOCK_BITS = 1 << BLOCK_SHIFT };
+
+	struct alignas(64) Block
+	{
+		uint64_t w[BLOCK_BITS / 64];
+	};
+
+	size_t block_index(uint64_t hash) const
+	{
+		return (size_t)((hash >> 32) * data_.size() >> 32);
+	}
+
+	MemBuffer<Block> data_;
+	unsigned k_;
+
+};
+
+#endif
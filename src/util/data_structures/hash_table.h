@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdexcept>
 #include <stdlib.h>
+#include "../simd.h"
 
 template<typename _K, typename _V, typename _HashFunction>
 struct HashTable : private _HashFunction
@@ -70,6 +71,15 @@ struct HashTable : private _HashFunction
 		return get_or_insert_entry(key);
 	}
 
+	void prefetch(_K key) const
+	{
+#ifdef __SSE__
+		_mm_prefetch((const char*)&table[_HashFunction::operator()(key)], _MM_HINT_T0);
+#elif defined(__GNUC__)
+		__builtin_prefetch(&table[_HashFunction::operator()(key)]);
+#endif
+	}
+
 	size_t size() const
 	{
 		return size_;
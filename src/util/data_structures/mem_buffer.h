@@ -21,6 +21,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MEM_BUFFER_H_
 
 #include <stdlib.h>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
 
 template<typename _t>
 struct MemBuffer {
@@ -32,19 +36,19 @@ struct MemBuffer {
 	{}
 
 	MemBuffer(size_t n):
-		data_((_t*)malloc(n * sizeof(_t))),
+		data_(alloc(n)),
 		size_(n),
 		alloc_size_(n)
 	{}
 
 	~MemBuffer() {
-		free(data_);
+		dealloc(data_);
 	}
 
 	void resize(size_t n) {
 		if (alloc_size_ < n) {
-			free(data_);
-			data_ = (_t*)malloc(n * sizeof(_t));
+			dealloc(data_);
+			data_ = alloc(n);
 			alloc_size_ = n;
 		}
 		size_ = n;
@@ -66,8 +70,36 @@ struct MemBuffer {
 		return data_[i];
 	}
 
+	const _t& operator[](size_t i) const {
+		return data_[i];
+	}
+
 private:
 
+	// Wide SIMD types (__m256i, __m512i) need more than the default malloc alignment.
+	enum { ALIGNMENT = alignof(_t) > sizeof(void*) ? alignof(_t) : sizeof(void*) };
+
+	static _t* alloc(size_t n) {
+#ifdef _MSC_VER
+		void *p = _aligned_malloc(n * sizeof(_t), ALIGNMENT);
+		if (p == nullptr)
+			throw std::bad_alloc();
+#else
+		void *p;
+		if (posix_memalign(&p, ALIGNMENT, n * sizeof(_t)) != 0)
+			throw std::bad_alloc();
+#endif
+		return (_t*)p;
+	}
+
+	static void dealloc(_t *p) {
+#ifdef _MSC_VER
+		_aligned_free(p);
+#else
+		free(p);
+#endif
+	}
+
 	_t *data_;
 	size_t size_, alloc_size_;
 
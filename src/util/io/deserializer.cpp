@@ -92,6 +92,15 @@ size_t Deserializer::read_raw(char *ptr, size_t count)
 	return total;
 }
 
+size_t Deserializer::read_bulk(char *ptr, size_t count)
+{
+	size_t total = std::min(count, avail()), n;
+	pop(ptr, total);
+	while (total < count && (n = buffer_->read(ptr + total, count - total)) > 0)
+		total += n;
+	return total;
+}
+
 bool Deserializer::fetch()
 {
 	if (buffer_ == NULL)
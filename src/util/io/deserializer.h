@@ -135,6 +135,8 @@ struct Deserializer
 	}
 
 	size_t read_raw(char *ptr, size_t count);
+	// Like read_raw, but the part that is not buffered yet is read directly into ptr, for large contiguous reads.
+	size_t read_bulk(char *ptr, size_t count);
 	bool read_until(std::string &dst, char delimiter);
 	bool read_until(std::vector<char> &dst, char delimiter);
 	DynamicRecordReader read_record();
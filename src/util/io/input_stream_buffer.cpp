@@ -46,4 +46,8 @@ pair<const char*, const char*> InputStreamBuffer::read()
 {
 	size_t n = prev_->read(buf_, BUF_SIZE);
 	return make_pair(buf_, buf_ + n);
+}
+size_t InputStreamBuffer::read(char *ptr, size_t count)
+{
+	return prev_->read(ptr, count);
 }
\ No newline at end of file
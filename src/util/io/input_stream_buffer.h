@@ -29,6 +29,7 @@ struct InputStreamBuffer : public StreamEntity
 	virtual void seek(size_t pos);
 	virtual void seek_forward(size_t n);
 	virtual pair<const char*, const char*> read();
+	virtual size_t read(char *ptr, size_t count);
 private:
 	enum { BUF_SIZE = 4096 };
 
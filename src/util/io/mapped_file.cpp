@@ -0,0 +1,110 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#ifdef _MSC_VER
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <stdexcept>
+#include "mapped_file.h"
+#include "exceptions.h"
+
+using std::string;
+using std::runtime_error;
+
+#ifdef _MSC_VER
+
+MappedFile::MappedFile(const string &file_name, bool copy_on_write) :
+	file_name_(file_name),
+	data_(nullptr),
+	size_(0),
+	file_(INVALID_HANDLE_VALUE),
+	mapping_(NULL)
+{
+	file_ = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file_ == INVALID_HANDLE_VALUE)
+		throw File_open_exception(file_name);
+	LARGE_INTEGER s;
+	if (!GetFileSizeEx(file_, &s)) {
+		CloseHandle(file_);
+		throw runtime_error("Error determining size of file " + file_name);
+	}
+	size_ = (size_t)s.QuadPart;
+	if (size_ == 0)
+		return;
+	mapping_ = CreateFileMapping(file_, NULL, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+	if (mapping_ == NULL) {
+		CloseHandle(file_);
+		throw runtime_error("Error mapping file " + file_name);
+	}
+	data_ = (char*)MapViewOfFile(mapping_, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+	if (data_ == nullptr) {
+		CloseHandle(mapping_);
+		CloseHandle(file_);
+		throw runtime_error("Error mapping file " + file_name);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (data_)
+		UnmapViewOfFile(data_);
+	if (mapping_ != NULL)
+		CloseHandle(mapping_);
+	CloseHandle(file_);
+}
+
+#else
+
+MappedFile::MappedFile(const string &file_name, bool copy_on_write) :
+	file_name_(file_name),
+	data_(nullptr),
+	size_(0)
+{
+	const int fd = open(file_name.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw File_open_exception(file_name);
+	struct stat s;
+	if (fstat(fd, &s) != 0) {
+		close(fd);
+		throw runtime_error("Error determining size of file " + file_name);
+	}
+	size_ = (size_t)s.st_size;
+	if (size_ == 0) {
+		close(fd);
+		return;
+	}
+	void *p = copy_on_write ? mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		throw runtime_error("Error mapping file " + file_name);
+	data_ = (char*)p;
+}
+
+MappedFile::~MappedFile()
+{
+	if (data_)
+		munmap(data_, size_);
+}
+
+#endif
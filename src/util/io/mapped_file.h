@@ -0,0 +1,61 @@
+/****
+DIAMOND protein aligner
+Copyright (C) 2013-2020 Benjamin Buchfink <buchfink@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+****/
+
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <string>
+
+// Memory mapping of a complete file. The file is mapped read-only, or copy-on-write if the
+// mapped data is to be modified without affecting the file.
+struct MappedFile
+{
+
+	MappedFile(const std::string &file_name, bool copy_on_write = false);
+	~MappedFile();
+
+	char* data() const
+	{
+		return data_;
+	}
+
+	size_t size() const
+	{
+		return size_;
+	}
+
+	std::string file_name() const
+	{
+		return file_name_;
+	}
+
+private:
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const std::string file_name_;
+	char *data_;
+	size_t size_;
+#ifdef _MSC_VER
+	void *file_, *mapping_;
+#endif
+
+};
+
+#endif
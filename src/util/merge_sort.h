@@ -21,28 +21,34 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <algorithm>
 #include <stddef.h>
-#include <thread>
+#include <vector>
+#include <utility>
+#include "parallel/thread_pool.h"
 
 template<typename _it>
-void merge_sort(_it begin, _it end, unsigned n_threads, unsigned level = 0)
+void merge_sort(_it begin, _it end, unsigned n_threads)
 {
-	ptrdiff_t diff = end - begin;
-	if(diff <= 1)
-		return;
-
-	if(1u << level >= n_threads) {
-		std::sort(begin, end);
-		return;
-	}
-
-	_it mid = begin + diff/2;
-	std::thread *left = new std::thread(merge_sort<_it>, begin, mid, n_threads, level+1);
-	std::thread *right = new std::thread(merge_sort<_it>, mid, end, n_threads, level+1);
-	left->join();
-	right->join();
-	delete left;
-	delete right;
-	std::inplace_merge(begin, mid, end);
+	unsigned levels = 0;
+	while ((1u << levels) < n_threads)
+		++levels;
+	std::vector<std::vector<std::pair<_it, _it>>> tree(levels + 1);
+	tree[0].emplace_back(begin, end);
+	for (unsigned l = 0; l < levels; ++l)
+		for (const std::pair<_it, _it> &r : tree[l]) {
+			const _it mid = r.first + (r.second - r.first) / 2;
+			tree[l + 1].emplace_back(r.first, mid);
+			tree[l + 1].emplace_back(mid, r.second);
+		}
+
+	Util::Parallel::ThreadPool &pool = Util::Parallel::ThreadPool::get();
+	pool.run(n_threads, tree[levels].size(), [&](size_t i, size_t thread_id) {
+		std::sort(tree[levels][i].first, tree[levels][i].second);
+	});
+	for (unsigned l = levels; l-- > 0;)
+		pool.run(n_threads, tree[l].size(), [&](size_t i, size_t thread_id) {
+			const std::pair<_it, _it> &r = tree[l][i];
+			std::inplace_merge(r.first, r.first + (r.second - r.first) / 2, r.second);
+		});
 }
 
 #endif /* MERGE_SORT_H_ */
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include "thread_pool.h"
+#include "../../basic/config.h"
+#include "../system/numa.h"
+
+using std::atomic;
+using std::unique_lock;
+using std::mutex;
+using std::vector;
+
+namespace Util { namespace Parallel {
+
+struct alignas(64) Range
+{
+	// Largest end position that can be packed.
+	static const uint64_t MAX_END = UINT32_MAX;
+	static uint64_t pack(uint64_t begin, uint64_t end)
+	{
+		return (end << 32) | begin;
+	}
+	static uint64_t begin(uint64_t r)
+	{
+		return r & 0xffffffffllu;
+	}
+	static uint64_t end(uint64_t r)
+	{
+		return r >> 32;
+	}
+	atomic<uint64_t> r;
+};
+
+struct ThreadPool::Job
+{
+
+	Job(size_t thread_count, size_t n, const Task &f) :
+		f(f),
+		ranges(thread_count),
+		taken(thread_count, false),
+		claimed(1),
+		participants(0)
+	{
+		taken[0] = true;
+		for (size_t i = 0; i < thread_count; ++i)
+			ranges[i].r = Range::pack(n * i / thread_count, n * (i + 1) / thread_count);
+	}
+
+	bool pop(size_t thread_id, size_t &i)
+	{
+		atomic<uint64_t> &r = ranges[thread_id].r;
+		uint64_t x = r.load();
+		while (Range::begin(x) < Range::end(x))
+			if (r.compare_exchange_weak(x, Range::pack(Range::begin(x) + 1, Range::end(x)))) {
+				i = Range::begin(x);
+				return true;
+			}
+		return false;
+	}
+
+	bool steal(size_t thread_id)
+	{
+		const size_t n = ranges.size();
+		for (size_t j = 1; j < n; ++j) {
+			atomic<uint64_t> &victim = ranges[(thread_id + j) % n].r;
+			uint64_t x = victim.load();
+			while (Range::begin(x) < Range::end(x)) {
+				const uint64_t b = Range::begin(x), e = Range::end(x), mid = b + (e - b) / 2;
+				if (victim.compare_exchange_weak(x, Range::pack(b, mid))) {
+					ranges[thread_id].r = Range::pack(mid, e);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	// Takes a free thread slot, preferring the slot of the same index as the worker. Requires the pool mutex.
+	size_t claim(size_t worker_id)
+	{
+		size_t slot = worker_id;
+		if (slot >= taken.size() || taken[slot])
+			slot = std::find(taken.begin(), taken.end(), false) - taken.begin();
+		taken[slot] = true;
+		++claimed;
+		++participants;
+		return slot;
+	}
+
+	void work(size_t thread_id)
+	{
+		size_t i;
+		try {
+			do {
+				while (pop(thread_id, i))
+					f(i, thread_id);
+			} while (steal(thread_id));
+		}
+		catch (...) {
+			std::lock_guard<mutex> lock(error_mtx);
+			if (!error)
+				error = std::current_exception();
+		}
+	}
+
+	const Task &f;
+	vector<Range> ranges;
+	// Guarded by the pool mutex.
+	vector<bool> taken;
+	size_t claimed, participants;
+	mutex error_mtx;
+	std::exception_ptr error;
+
+};
+
+ThreadPool::ThreadPool() :
+	stop_(false)
+{}
+
+ThreadPool& ThreadPool::get()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::start(size_t worker_count)
+{
+	for (size_t i = threads_.size(); i < worker_count; ++i)
+		threads_.emplace_back(&ThreadPool::worker, this, i + 1);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<mutex> lock(mtx_);
+		stop_ = true;
+	}
+	cv_.notify_all();
+	for (std::thread &t : threads_)
+		t.join();
+}
+
+ThreadPool::Job* ThreadPool::next_job()
+{
+	for (auto it = jobs_.rbegin(); it != jobs_.rend(); ++it)
+		if ((*it)->claimed < (*it)->ranges.size())
+			return *it;
+	return nullptr;
+}
+
+void ThreadPool::worker(size_t thread_id)
+{
+	// Only the workers are pinned, threads calling into the pool keep their affinity.
+	Numa::pin_thread(thread_id);
+	unique_lock<mutex> lock(mtx_);
+	for (;;) {
+		Job *job;
+		cv_.wait(lock, [this, &job] { return stop_ || (job = next_job()) != nullptr; });
+		if (stop_)
+			return;
+		const size_t slot = job->claim(thread_id);
+		lock.unlock();
+		job->work(slot);
+		lock.lock();
+		if (--job->participants == 0)
+			done_cv_.notify_all();
+	}
+}
+
+void ThreadPool::run(size_t thread_count, size_t n, const Task &f)
+{
+	thread_count = std::max(std::min(thread_count, n), (size_t)1);
+	if (n == 0)
+		return;
+	if (thread_count == 1) {
+		for (size_t i = 0; i < n; ++i)
+			f(i, 0);
+		return;
+	}
+	if (n > Range::MAX_END) {
+		// Ranges are packed into 32 bits, so longer loops are run in chunks.
+		for (size_t begin = 0; begin < n; begin += Range::MAX_END)
+			run(thread_count, std::min(n - begin, (size_t)Range::MAX_END), [&f, begin](size_t i, size_t thread_id) { f(begin + i, thread_id); });
+		return;
+	}
+	Job job(thread_count, n, f);
+	{
+		std::lock_guard<mutex> lock(mtx_);
+		start(std::max(thread_count, (size_t)config.threads_) - 1);
+		jobs_.push_back(&job);
+	}
+	cv_.notify_all();
+	job.work(0);
+	{
+		// All iterations have been taken. Withdraw the job and wait for the workers that still process some.
+		unique_lock<mutex> lock(mtx_);
+		jobs_.erase(std::find(jobs_.begin(), jobs_.end(), &job));
+		done_cv_.wait(lock, [&job] { return job.participants == 0; });
+	}
+	if (job.error)
+		std::rethrow_exception(job.error);
+}
+
+}}
@@ -4,9 +4,51 @@
 #include <thread>
 #include <atomic>
 #include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <stdint.h>
 
 namespace Util { namespace Parallel {
 
+/* Persistent pool of worker threads that executes parallel loops. The iteration range of a loop is split evenly over
+the participating threads, and a thread that runs out of work steals half of the remaining range of another thread.
+Ranges are stored as packed (begin, end) pairs and updated by compare-and-swap only. The calling thread participates
+in the loop as thread 0, idle workers join it for the remaining thread slots. Several loops can be active at the same
+time, e.g. loops nested in the tasks of another loop or loops started by other threads. Idle workers join the most
+recently started loop first, so that a nested loop is finished before new tasks of the enclosing loop are begun. A loop
+never waits for workers to become available: slots that are not taken are drained by stealing. */
+
+struct ThreadPool
+{
+
+	typedef std::function<void(size_t, size_t)> Task;
+
+	// Calls f(i, thread_id) for all i in [0, n) using at most thread_count threads and returns when all calls finished.
+	// Exceptions thrown by f are rethrown.
+	void run(size_t thread_count, size_t n, const Task &f);
+
+	static ThreadPool& get();
+	~ThreadPool();
+
+private:
+
+	struct Job;
+
+	ThreadPool();
+	void start(size_t worker_count);
+	void worker(size_t thread_id);
+	Job* next_job();
+
+	std::vector<std::thread> threads_;
+	std::mutex mtx_;
+	std::condition_variable cv_, done_cv_;
+	std::vector<Job*> jobs_;
+	bool stop_;
+
+};
+
 template<typename _f, typename... _args>
 void pool_worker(std::atomic<size_t> *partition, size_t thread_id, size_t partition_count, _f f, _args... args) {
 	size_t p;
@@ -27,9 +69,9 @@ void scheduled_thread_pool(size_t thread_count, _f f, _args... args) {
 
 template<typename _f, typename... _args>
 void scheduled_thread_pool_auto(size_t thread_count, size_t partition_count, _f f, _args... args) {
-	scheduled_thread_pool(thread_count, pool_worker<_f, _args...>, partition_count, f, args...);
+	ThreadPool::get().run(thread_count, partition_count, [&](size_t p, size_t thread_id) { f(p, thread_id, args...); });
 }
 
 }}
 
-#endif
\ No newline at end of file
+#endif
@@ -22,6 +22,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #ifdef _WIN32
 #define cpuid(info,x)    __cpuidex(info,x,0)
+inline unsigned long long xgetbv() {
+	return _xgetbv(0);
+}
 #else
 inline void cpuid(int CPUInfo[4], int InfoType) {
 	__asm__ __volatile__(
@@ -33,6 +36,11 @@ inline void cpuid(int CPUInfo[4], int InfoType) {
 		"a" (InfoType), "c" (0)
 		);
 }
+inline unsigned long long xgetbv() {
+	unsigned eax, edx;
+	__asm__ __volatile__("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+	return ((unsigned long long)edx << 32) | eax;
+}
 #endif
 
 namespace SIMD {
@@ -56,6 +64,16 @@ Arch init_arch() {
 		flags |= POPCNT;
 	if ((info[2] & (1 << 19)) != 0)
 		flags |= SSE4_1;
+
+	// The wide register files are only usable if the OS saves them on context switches (OSXSAVE/XCR0).
+	if ((info[2] & (1 << 27)) != 0 && nids >= 7) {
+		const unsigned long long xcr0 = xgetbv();
+		cpuid(info, 7);
+		if ((xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0)
+			flags |= AVX2;
+		if ((xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0)
+			flags |= AVX512BW;
+	}
 #endif
 
 #ifdef __SSSE3__
@@ -70,7 +88,15 @@ Arch init_arch() {
 	if ((flags & SSE4_1) == 0)
 		throw std::runtime_error("CPU does not support SSE4.1. Please compile the software from source.");
 #endif
+#ifdef __AVX2__
+	if ((flags & AVX2) == 0)
+		throw std::runtime_error("CPU does not support AVX2. Please compile the software from source.");
+#endif
 
+	if ((flags & SSSE3) && (flags & POPCNT) && (flags & SSE4_1) && (flags & AVX2) && (flags & AVX512BW))
+		return Arch::AVX512BW;
+	if ((flags & SSSE3) && (flags & POPCNT) && (flags & SSE4_1) && (flags & AVX2))
+		return Arch::AVX2;
 	if ((flags & SSSE3) && (flags & POPCNT) && (flags & SSE4_1))
 		return Arch::SSE4_1;
 	else
@@ -90,6 +116,10 @@ std::string features() {
 		r.push_back("popcnt");
 	if (flags & SSE4_1)
 		r.push_back("sse4.1");
+	if (flags & AVX2)
+		r.push_back("avx2");
+	if (flags & AVX512BW)
+		r.push_back("avx512bw");
 	return r.empty() ? "None" : join(" ", r);
 }
 
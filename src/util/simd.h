@@ -32,14 +32,30 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifdef __SSE4_1__
 #include <smmintrin.h>
 #endif
+#if defined(__AVX2__) || defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
 #ifdef _MSC_VER
 #include <intrin.h>
 #endif
 
+// Types whose layout or code depends on the instruction set (e.g. score_vector<int16_t>) are placed
+// into a separate inline namespace per dispatch target, so that the object files compiled for
+// different targets do not share (and the linker does not merge) their symbols.
+#ifdef DISPATCH_ARCH
+#define SIMD_CONCAT_(x, y) x##y
+#define SIMD_CONCAT(x, y) SIMD_CONCAT_(x, y)
+#define BEGIN_DISPATCH_TYPES inline namespace SIMD_CONCAT(Types_, DISPATCH_ARCH) {
+#define END_DISPATCH_TYPES }
+#else
+#define BEGIN_DISPATCH_TYPES
+#define END_DISPATCH_TYPES
+#endif
+
 namespace SIMD {
 
-enum class Arch { None, Generic, SSE4_1 };
-enum Flags { SSSE3 = 1, POPCNT = 2, SSE4_1 = 4 };
+enum class Arch { None, Generic, SSE4_1, AVX2, AVX512BW };
+enum Flags { SSSE3 = 1, POPCNT = 2, SSE4_1 = 4, AVX2 = 8, AVX512BW = 16 };
 Arch arch();
 
 #if defined(_M_AMD64) && defined(_MSC_VER)
@@ -49,15 +65,21 @@ Arch arch();
 #ifdef __SSE__
 #define DECL_DISPATCH(ret, name, param) namespace ARCH_GENERIC { ret name param; }\
 namespace ARCH_SSE4_1 { ret name param; }\
+namespace ARCH_AVX2 { ret name param; }\
+namespace ARCH_AVX512BW { ret name param; }\
 inline std::function<decltype(ARCH_GENERIC::name)> dispatch_target_##name() {\
 switch(SIMD::arch()) {\
 case SIMD::Arch::SSE4_1: return ARCH_SSE4_1::name;\
+case SIMD::Arch::AVX2: return ARCH_AVX2::name;\
+case SIMD::Arch::AVX512BW: return ARCH_AVX512BW::name;\
 default: return ARCH_GENERIC::name;\
 }}\
 const std::function<decltype(ARCH_GENERIC::name)> name = dispatch_target_##name();
 #else
 #define DECL_DISPATCH(ret, name, param) namespace ARCH_GENERIC { ret name param; }\
 namespace ARCH_SSE4_1 { ret name param; }\
+namespace ARCH_AVX2 { ret name param; }\
+namespace ARCH_AVX512BW { ret name param; }\
 inline std::function<decltype(ARCH_GENERIC::name)> dispatch_target_##name() {\
 return ARCH_GENERIC::name;\
 }\
@@ -66,6 +88,46 @@ const std::function<decltype(ARCH_GENERIC::name)> name = dispatch_target_##name(
 
 std::string features();
 
+template<size_t _bytes>
+struct Vector
+{ };
+
+#ifdef __SSE2__
+template<>
+struct Vector<16>
+{
+	typedef __m128i Type;
+	static Type loadu(const void *p)
+	{
+		return _mm_loadu_si128((const __m128i*)p);
+	}
+};
+#endif
+
+#ifdef __AVX2__
+template<>
+struct Vector<32>
+{
+	typedef __m256i Type;
+	static Type loadu(const void *p)
+	{
+		return _mm256_loadu_si256((const __m256i*)p);
+	}
+};
+#endif
+
+#ifdef __AVX512BW__
+template<>
+struct Vector<64>
+{
+	typedef __m512i Type;
+	static Type loadu(const void *p)
+	{
+		return _mm512_loadu_si512(p);
+	}
+};
+#endif
+
 };
 
 #endif
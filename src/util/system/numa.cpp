@@ -0,0 +1,78 @@
+#include <stdint.h>
+#include <algorithm>
+#include "numa.h"
+#include "../../basic/config.h"
+#include "../log_stream.h"
+#ifdef WITH_NUMA
+#include <numa.h>
+#include <numaif.h>
+#include <unistd.h>
+#endif
+
+namespace Numa {
+
+unsigned nodes()
+{
+#ifdef WITH_NUMA
+	static const unsigned n = config.numa && numa_available() >= 0 ? (unsigned)numa_max_node() + 1 : 1;
+	return n;
+#else
+	return 1;
+#endif
+}
+
+unsigned thread_node(size_t thread_id)
+{
+	const size_t threads = std::max((size_t)config.threads_, thread_id + 1);
+	return (unsigned)(thread_id * nodes() / threads);
+}
+
+void pin_thread(size_t thread_id)
+{
+#ifdef WITH_NUMA
+	if (nodes() > 1)
+		numa_run_on_node((int)thread_node(thread_id));
+#endif
+}
+
+#ifdef WITH_NUMA
+// Restricts [p, p + size) to the pages fully contained in it.
+static bool page_range(void *p, size_t size, uintptr_t &begin, uintptr_t &end)
+{
+	const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+	begin = ((uintptr_t)p + page - 1) / page * page;
+	end = ((uintptr_t)p + size) / page * page;
+	return begin < end;
+}
+#endif
+
+void distribute(void *p, size_t size)
+{
+#ifdef WITH_NUMA
+	const unsigned n = nodes();
+	if (n <= 1)
+		return;
+	for (unsigned i = 0; i < n; ++i) {
+		uintptr_t begin, end;
+		if (page_range((char*)p + size * i / n, size * (i + 1) / n - size * i / n, begin, end))
+			numa_tonode_memory((void*)begin, end - begin, (int)i);
+	}
+#endif
+}
+
+void interleave(void *p, size_t size)
+{
+#ifdef WITH_NUMA
+	if (nodes() <= 1)
+		return;
+	uintptr_t begin, end;
+	if (!page_range(p, size, begin, end))
+		return;
+	struct bitmask *mask = numa_get_mems_allowed();
+	if (mbind((void*)begin, end - begin, MPOL_INTERLEAVE, mask->maskp, mask->size + 1, MPOL_MF_MOVE) != 0)
+		log_stream << "NUMA interleaving failed." << std::endl;
+	numa_bitmask_free(mask);
+#endif
+}
+
+}
@@ -0,0 +1,25 @@
+#ifndef UTIL_SYSTEM_NUMA_H_
+#define UTIL_SYSTEM_NUMA_H_
+
+#include <stddef.h>
+
+/* NUMA placement of threads and memory. All functions are no-ops unless DIAMOND was built with libnuma (WITH_NUMA),
+--numa is set and the system has more than one node. Pool threads are assigned to nodes in contiguous groups, matching
+the contiguous split of loop ranges in ThreadPool, so that thread i mostly works on the i-th slice of a loop. */
+
+namespace Numa {
+
+// Number of nodes used for placement (1 if disabled).
+unsigned nodes();
+// Node of pool thread thread_id.
+unsigned thread_node(size_t thread_id);
+// Restricts the calling thread to the CPUs of its node.
+void pin_thread(size_t thread_id);
+// Places equally sized contiguous slices of [p, p + size) on the nodes in order. Only affects pages not touched yet.
+void distribute(void *p, size_t size);
+// Interleaves the pages of [p, p + size) over all nodes, migrating pages that are already present.
+void interleave(void *p, size_t size);
+
+}
+
+#endif
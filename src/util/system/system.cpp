@@ -47,6 +47,21 @@ void auto_append_extension_if_exists(string &str, const char *ext) {
 			str += ext;
 }
 
+size_t available_memory() {
+#ifdef _MSC_VER
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	if (!GlobalMemoryStatusEx(&status))
+		return 0;
+	return (size_t)status.ullAvailPhys;
+#elif defined(_SC_AVPHYS_PAGES)
+	const long pages = sysconf(_SC_AVPHYS_PAGES), page_size = sysconf(_SC_PAGESIZE);
+	return pages > 0 && page_size > 0 ? (size_t)pages * (size_t)page_size : 0;
+#else
+	return 0;
+#endif
+}
+
 void log_rss() {
 	log_stream << "Current RSS: " << convert_size(getCurrentRSS()) << ", Peak RSS: " << convert_size(getPeakRSS()) << endl;
 }
\ No newline at end of file
@@ -10,6 +10,8 @@ void auto_append_extension(std::string &str, const char *ext);
 void auto_append_extension_if_exists(std::string &str, const char *ext);
 size_t getCurrentRSS();
 size_t getPeakRSS();
+// Physical memory currently available to the process in bytes, or 0 if unknown.
+size_t available_memory();
 void log_rss();
 
 #ifdef _MSC_VER
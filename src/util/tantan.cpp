@@ -25,8 +25,12 @@ A new repeat-masking method enables specific detection of homologous sequences,
 #include <array>
 #include <stdint.h>
 #include <algorithm>
-#include <Eigen/Core>
 #include "../basic/value.h"
+#include "simd.h"
+// This file is compiled once per dispatch target. Eigen's inline functions (e.g. its aligned heap
+// allocator) depend on the instruction set, so every target gets its own copy of the namespace.
+#define Eigen SIMD_CONCAT(Eigen_, DISPATCH_ARCH)
+#include <Eigen/Core>
 
 using Eigen::Array;
 using Eigen::Dynamic;